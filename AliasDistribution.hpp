@@ -0,0 +1,103 @@
+/*
+ * AliasDistribution.hpp
+ *
+ * Copyright (c) 2012 Tsukasa OMOTO <henry0312@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/* This file is available under an MIT license. */
+
+#ifndef ALIAS_DISTRIBUTION_H
+#define ALIAS_DISTRIBUTION_H
+
+#include <vector>
+#include <random>
+#include <iterator>
+
+/**
+ * Discrete distribution sampled in O(1) by Walker's alias method
+ *
+ * @see Michael D. Vose. A linear algorithm for generating random numbers with a given distribution. IEEE Transactions on Software Engineering, 17(9):972-975, 1991.
+ */
+class alias_distribution
+{
+    std::vector<double> prob;
+    std::vector<int> alias;
+public:
+    alias_distribution() = default;
+    ~alias_distribution() = default;
+    template <class InputIt> void build(InputIt first, InputIt last);
+    template <class Generator> int operator()(Generator& gen) const;
+    int size() const { return prob.size(); }
+};
+
+/**
+ * Build the table
+ *
+ * @param InputIt first the first weight (not necessarily normalized)
+ * @param InputIt last the end of the weights
+ */
+template <class InputIt>
+void alias_distribution::build(InputIt first, InputIt last) {
+    const int n = std::distance(first, last);
+    prob.assign(first, last);
+    alias.resize(n);
+
+    double sum = 0.0;
+    for (auto p : prob) {
+        sum += p;
+    }
+
+    std::vector<int> small, large;
+    for (int i = 0; i < n; ++i) {
+        prob[i] *= n / sum;
+        alias[i] = i;
+        if (prob[i] < 1.0) {
+            small.push_back(i);
+        } else {
+            large.push_back(i);
+        }
+    }
+
+    while (!small.empty() && !large.empty()) {
+        const int s = small.back(); small.pop_back();
+        const int l = large.back();
+        alias[s] = l;
+        prob[l] -= 1.0 - prob[s];
+        if (prob[l] < 1.0) {
+            large.pop_back();
+            small.push_back(l);
+        }
+    }
+
+    // rounding errors
+    for (auto i : small) {
+        prob[i] = 1.0;
+    }
+    for (auto i : large) {
+        prob[i] = 1.0;
+    }
+}
+
+/**
+ * Generates the next random number in the distribution
+ *
+ * @param Generator& gen an uniform random number generator object
+ */
+template <class Generator>
+int alias_distribution::operator()(Generator& gen) const {
+    std::uniform_real_distribution<> dis(0.0, prob.size());
+    const double u = dis(gen);
+    int i = static_cast<int>(u);
+    if (i >= static_cast<int>(prob.size())) {
+        i = prob.size() - 1;
+    }
+    return (u - i < prob[i]) ? i : alias[i];
+}
+
+#endif
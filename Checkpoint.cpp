@@ -0,0 +1,140 @@
+/*
+ * Checkpoint.cpp
+ *
+ * Copyright (c) 2012 Tsukasa OMOTO <henry0312@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/* This file is available under an MIT license. */
+
+#include "Checkpoint.hpp"
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
+
+/**
+ * Magic number of checkpoints
+ */
+static const char checkpoint_magic[8] = "LDACKPT";
+static const uint32_t checkpoint_version = 4;
+
+/**
+ * Begin a snapshot
+ *
+ * Waits for the previous checkpoint to be written.
+ *
+ * @param const uint32_t type Model::Type of the sampler
+ * @param const uint64_t iteration the number of iterations done
+ * @param const DataSet& dataset Training set
+ */
+void CheckpointWriter::begin(const uint32_t type, const uint64_t iteration, const DataSet& dataset) {
+    wait();
+
+    CheckpointHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, checkpoint_magic, sizeof(checkpoint_magic));
+    header.version      = checkpoint_version;
+    header.type         = type;
+    header.iteration    = iteration;
+    header.M            = dataset.M;
+    header.V            = dataset.V;
+    header.N            = dataset.N;
+
+    snapshot.clear();
+    put(header);
+}
+
+/**
+ * Write the snapshot to a file in the background
+ *
+ * @param const std::string& filename checkpoint file, replaced atomically
+ */
+void CheckpointWriter::commit(const std::string& filename) {
+    worker = std::thread([this, filename]() {
+        const std::string tmp = filename + ".tmp";
+        const int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        bool ok = fd >= 0;
+        size_t done = 0;
+        while (ok && done < snapshot.size()) {
+            const ssize_t n = ::write(fd, snapshot.data() + done, snapshot.size() - done);
+            ok = n > 0;
+            done += ok ? n : 0;
+        }
+        ok = ok && fsync(fd) == 0;
+        if (fd >= 0) {
+            ok = (::close(fd) == 0) && ok;
+        }
+        if (!ok || std::rename(tmp.c_str(), filename.c_str()) != 0) {
+            std::cerr << "Can't write the checkpoint: " << filename << std::endl;
+            std::remove(tmp.c_str());
+        }
+    });
+}
+
+/**
+ * Wait for the checkpoint being written
+ */
+void CheckpointWriter::wait() {
+    if (worker.joinable()) {
+        worker.join();
+    }
+}
+
+/**
+ * Open a checkpoint
+ *
+ * @param const char *_filename checkpoint file
+ * @param const uint32_t type Model::Type of the sampler
+ * @param const DataSet& dataset Training set, which must be the one of the checkpoint
+ */
+void CheckpointReader::open(const char *_filename, const uint32_t type, const DataSet& dataset) {
+    filename = _filename;
+    if (!file.open(_filename)) {
+        std::cerr << "Can't open the file: " << filename << std::endl;
+        exit(1);
+    }
+    p = file.data();
+    end = p + file.size();
+
+    if (file.size() < sizeof(header) || std::memcmp(p, checkpoint_magic, sizeof(checkpoint_magic)) != 0) {
+        std::cerr << "Not a checkpoint: " << filename << std::endl;
+        exit(1);
+    }
+    get(header);
+    if (header.version != checkpoint_version || header.type != type) {
+        std::cerr << "Unsupported checkpoint: " << filename << std::endl;
+        exit(1);
+    }
+    if (header.M != static_cast<uint64_t>(dataset.M) || header.V != static_cast<uint64_t>(dataset.V)
+            || header.N != static_cast<uint64_t>(dataset.N)) {
+        std::cerr << "The checkpoint doesn't match the training set: " << filename << std::endl;
+        exit(1);
+    }
+}
+
+/**
+ * Read bytes
+ *
+ * @param void *dest output
+ * @param const size_t size the number of bytes
+ */
+void CheckpointReader::read(void *dest, const size_t size) {
+    if (size > static_cast<size_t>(end - p)) {
+        truncated();
+    }
+    std::memcpy(dest, p, size);
+    p += size;
+}
+
+/**
+ * Exit on a truncated checkpoint
+ */
+void CheckpointReader::truncated() {
+    std::cerr << "Truncated file: " << filename << std::endl;
+    exit(1);
+}
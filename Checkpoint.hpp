@@ -0,0 +1,150 @@
+/*
+ * Checkpoint.hpp
+ *
+ * Copyright (c) 2012 Tsukasa OMOTO <henry0312@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/* This file is available under an MIT license. */
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <sstream>
+#include <random>
+#include <thread>
+#include <cstring>
+#include <cstdint>
+#include <type_traits>
+#include "MappedFile.hpp"
+#include "DataSet.hpp"
+
+/**
+ * Header of a checkpoint
+ *
+ * The header is followed by the state of the sampler, written by CheckpointWriter::put().
+ * A vector is its size as uint64_t and its elements, in the native byte order.
+ */
+struct CheckpointHeader {
+    char magic[8];      // "LDACKPT"
+    uint32_t version;
+    uint32_t type;      // Model::Type
+    uint64_t iteration; // the number of iterations done
+    uint64_t M;         // the training set, which must be the same on resuming
+    uint64_t V;
+    uint64_t N;
+};
+
+/**
+ * Checkpoint writer
+ *
+ * The state is copied into a snapshot by put(), and commit() writes the snapshot in a background thread,
+ * so that the sampler can go on while the file is being written.
+ * A checkpoint is written to a temporary file and renamed, so a crash never leaves a broken checkpoint.
+ */
+class CheckpointWriter {
+    std::string snapshot;
+    std::thread worker;
+public:
+    CheckpointWriter() = default;
+    CheckpointWriter(const CheckpointWriter&) = delete;
+    CheckpointWriter& operator=(const CheckpointWriter&) = delete;
+    ~CheckpointWriter() { wait(); }
+    void begin(const uint32_t type, const uint64_t iteration, const DataSet& dataset);
+    void commit(const std::string& filename);
+    void wait();
+
+    template <class T> void put(const T& value) {
+        static_assert(std::is_trivially_copyable<T>::value, "put() needs a trivially copyable type");
+        snapshot.append(reinterpret_cast<const char *>(&value), sizeof(T));
+    }
+    template <class T> void put(const std::vector<T>& values) {
+        put<uint64_t>(values.size());
+        snapshot.append(reinterpret_cast<const char *>(values.data()), values.size() * sizeof(T));
+    }
+    template <class T> void put(const T *values, const size_t size) {
+        put<uint64_t>(size);
+        snapshot.append(reinterpret_cast<const char *>(values), size * sizeof(T));
+    }
+    template <class T> void put(const std::vector<std::vector<T>>& values) {
+        put<uint64_t>(values.size());
+        for (const auto& value : values) {
+            put(value);
+        }
+    }
+    void put(const std::mt19937& gen) {
+        std::ostringstream oss;
+        oss << gen;
+        const std::string state = oss.str();
+        put(std::vector<char>(state.begin(), state.end()));
+    }
+};
+
+/**
+ * Checkpoint reader
+ *
+ * get() reads the state in the same order as it was put().
+ */
+class CheckpointReader {
+    MappedFile file;
+    const char *p;
+    const char *end;
+    std::string filename;
+
+    void read(void *dest, const size_t size);
+    void truncated();
+public:
+    CheckpointHeader header;
+
+    CheckpointReader() : p(nullptr), end(nullptr) {}
+    void open(const char *_filename, const uint32_t type, const DataSet& dataset);
+
+    template <class T> void get(T& value) {
+        static_assert(std::is_trivially_copyable<T>::value, "get() needs a trivially copyable type");
+        read(&value, sizeof(T));
+    }
+    template <class T> void get(std::vector<T>& values) {
+        uint64_t size;
+        get(size);
+        if (size > static_cast<uint64_t>(end - p) / sizeof(T)) {
+            truncated();
+        }
+        values.resize(size);
+        read(values.data(), size * sizeof(T));
+    }
+    template <class T> void get(T *values, const size_t size) {
+        uint64_t _size;
+        get(_size);
+        if (_size != size) {
+            truncated();
+        }
+        read(values, size * sizeof(T));
+    }
+    template <class T> void get(std::vector<std::vector<T>>& values) {
+        uint64_t size;
+        get(size);
+        if (size > static_cast<uint64_t>(end - p) / sizeof(uint64_t)) {
+            truncated();
+        }
+        values.resize(size);
+        for (auto& value : values) {
+            get(value);
+        }
+    }
+    void get(std::mt19937& gen) {
+        std::vector<char> state;
+        get(state);
+        std::istringstream iss(std::string(state.begin(), state.end()));
+        iss >> gen;
+    }
+};
+
+#endif
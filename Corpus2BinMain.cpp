@@ -0,0 +1,77 @@
+/*
+ * Corpus2BinMain.cpp
+ *
+ * Copyright (c) 2012 Tsukasa OMOTO <henry0312@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/* This file is available under an MIT license. */
+
+#include <iostream>
+#include <string>
+#include <boost/program_options.hpp>
+#include "DataSet.hpp"
+
+int main(int argc, char const* argv[])
+{
+    using namespace std;
+    using namespace boost::program_options;
+
+    // Set options
+    options_description opt("Options");
+    opt.add_options()
+        ("help,h",                                                  "show help")
+        ("input",       value<string>(),                            "Data set (docword format)")
+        ("output",      value<string>(),                            "Binary data set")
+        ("synthetic",                                               "write a synthetic data set instead of converting --input")
+        ("docs",        value<int>()->default_value(1000),          "the number of docs (synthetic)")
+        ("vocab_size",  value<int>()->default_value(10000),         "the number of vocabulary (synthetic)")
+        ("doc_length",  value<int>()->default_value(1000),          "the number of words of each doc (synthetic)")
+        ("seed,s",      value<unsigned int>()->default_value(1),    "seed value (synthetic)");
+
+    // Parse the arguments and Store the result in vm.
+    variables_map vm;
+    store(parse_command_line(argc, argv, opt), vm);
+    notify(vm);
+
+    if ( vm.count("help") || (!vm.count("input") && !vm.count("synthetic")) || !vm.count("output") ) {
+        cout << opt << endl;
+        return 1;
+    }
+
+    string output   = vm["output"].as<string>();
+
+    // Synthetic data set
+    if (vm.count("synthetic")) {
+        const int M             = vm["docs"].as<int>();
+        const int V             = vm["vocab_size"].as<int>();
+        const int doc_length    = vm["doc_length"].as<int>();
+        if (M < 1 || V < 16 || doc_length < 1) {
+            cerr << "--docs and --doc_length must be positive, and --vocab_size at least 16" << endl;
+            return 1;
+        }
+        DataSet::saveSynthetic(output.c_str(), M, V, doc_length, vm["seed"].as<unsigned int>());
+
+        cout << "M = " << M << endl;
+        cout << "V = " << V << endl;
+        cout << "N = " << static_cast<int64_t>(M) * doc_length << endl;
+        return 0;
+    }
+
+    string input    = vm["input"].as<string>();
+
+    // Convert
+    DataSet dataset(input.c_str());
+    dataset.saveBinary(output.c_str());
+
+    cout << "M = " << dataset.M << endl;
+    cout << "V = " << dataset.V << endl;
+    cout << "N = " << dataset.N << endl;
+
+    return 0;
+}
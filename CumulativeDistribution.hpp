@@ -0,0 +1,120 @@
+/*
+ * CumulativeDistribution.hpp
+ *
+ * Copyright (c) 2012 Tsukasa OMOTO <henry0312@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/* This file is available under an MIT license. */
+
+#ifndef CUMULATIVE_DISTRIBUTION_H
+#define CUMULATIVE_DISTRIBUTION_H
+
+#include <vector>
+#include <random>
+#include <algorithm>
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+/**
+ * Discrete distribution over unnormalized weights, drawn by searching their prefix sums
+ *
+ * Unlike std::discrete_distribution, the buffer is reused between draws,
+ * so no memory is allocated once it has grown to the largest size.
+ *
+ * Usage:
+ *   double *p = dis.weights(n);
+ *   // p[0], ..., p[n-1] = weights
+ *   int i = dis(n, gen);
+ */
+class cumulative_distribution
+{
+    std::vector<double> cum;
+    void prefix_sum(const int n);
+public:
+    cumulative_distribution() = default;
+    ~cumulative_distribution() = default;
+    double *weights(const int n);
+    template <class Generator> int operator()(const int n, Generator& gen);
+};
+
+/**
+ * Get the buffer to store weights
+ *
+ * @param const int n the number of weights
+ * @return the buffer which has at least n elements
+ */
+inline double *cumulative_distribution::weights(const int n) {
+    if (static_cast<int>(cum.size()) < n) {
+        cum.resize(n);
+    }
+    return cum.data();
+}
+
+/**
+ * Replace the weights with their prefix sums in place
+ *
+ * @param const int n the number of weights
+ */
+inline void cumulative_distribution::prefix_sum(const int n) {
+    double *p = cum.data();
+    int i = 0;
+#if defined(__AVX512F__)
+    const __m512i idx1 = _mm512_set_epi64(6, 5, 4, 3, 2, 1, 0, 0);
+    const __m512i idx2 = _mm512_set_epi64(5, 4, 3, 2, 1, 0, 0, 0);
+    const __m512i idx4 = _mm512_set_epi64(3, 2, 1, 0, 0, 0, 0, 0);
+    const __m512i last = _mm512_set1_epi64(7);
+    __m512d carry = _mm512_setzero_pd();
+    for (; i + 8 <= n; i += 8) {
+        __m512d x = _mm512_loadu_pd(p + i);
+        x = _mm512_add_pd(x, _mm512_maskz_permutexvar_pd(0xFE, idx1, x));
+        x = _mm512_add_pd(x, _mm512_maskz_permutexvar_pd(0xFC, idx2, x));
+        x = _mm512_add_pd(x, _mm512_maskz_permutexvar_pd(0xF0, idx4, x));
+        x = _mm512_add_pd(x, carry);
+        _mm512_storeu_pd(p + i, x);
+        carry = _mm512_maskz_permutexvar_pd(0xFF, last, x);
+    }
+#elif defined(__AVX2__)
+    const __m256d zero = _mm256_setzero_pd();
+    __m256d carry = zero;
+    for (; i + 4 <= n; i += 4) {
+        __m256d x = _mm256_loadu_pd(p + i);
+        // [a, b, c, d] + [0, a, b, c]
+        x = _mm256_add_pd(x, _mm256_blend_pd(_mm256_permute4x64_pd(x, 0x90), zero, 0x1));
+        // [a, ab, bc, cd] + [0, 0, a, ab]
+        x = _mm256_add_pd(x, _mm256_blend_pd(_mm256_permute4x64_pd(x, 0x40), zero, 0x3));
+        x = _mm256_add_pd(x, carry);
+        _mm256_storeu_pd(p + i, x);
+        carry = _mm256_permute4x64_pd(x, 0xFF);
+    }
+#endif
+    double sum = (i > 0) ? p[i - 1] : 0.0;
+    for (; i < n; ++i) {
+        sum += p[i];
+        p[i] = sum;
+    }
+}
+
+/**
+ * Generates the next random number in the distribution
+ *
+ * @param const int n the number of weights stored in weights(n)
+ * @param Generator& gen an uniform random number generator object
+ * @return an index in [0, n)
+ */
+template <class Generator>
+int cumulative_distribution::operator()(const int n, Generator& gen) {
+    prefix_sum(n);
+    std::uniform_real_distribution<> dis(0.0, 1.0);
+    const double u = dis(gen) * cum[n - 1];
+    const int i = std::upper_bound(cum.data(), cum.data() + n, u) - cum.data();
+    return (i < n) ? i : n - 1;
+}
+
+#endif
@@ -22,9 +22,12 @@
  * @param const char *dataset DataSet's filename
  */
 DataSet::DataSet(const char *dataset)
-    :M(0), V(0), N(0)
+    :words(nullptr), offsets(nullptr), M(0), V(0), N(0), load_time(0.0)
 {
+    auto start = std::chrono::system_clock::now();
     loadDataSet(dataset);
+    auto end = std::chrono::system_clock::now();
+    load_time = std::chrono::duration<double>(end - start).count();
 }
 
 /**
@@ -36,45 +39,489 @@ DataSet::DataSet(const char *dataset)
  * @param const char *vocab Vocabulary's filename
  */
 DataSet::DataSet(const char *dataset, const char *vocab)
-    :M(0), V(0), N(0)
+    :words(nullptr), offsets(nullptr), M(0), V(0), N(0), load_time(0.0)
 {
+    auto start = std::chrono::system_clock::now();
     loadDataSet(dataset);
     loadVocabulary(vocab);
+    auto end = std::chrono::system_clock::now();
+    load_time = std::chrono::duration<double>(end - start).count();
 }
 
+namespace {
+
 /**
- * Load a file and Initialize variables
+ * Check if a character separates integers
+ */
+inline bool is_space(const char c) {
+    return c == ' ' || c == '\n' || c == '\t' || c == '\r';
+}
+
+/**
+ * Parse a non-negative integer
+ *
+ * Integers are separated by white spaces. A sign, any other character, or an overflow makes the integer malformed,
+ * and then x is -1, which the range checks of the callers reject.
+ *
+ * @param const char *p the current position
+ * @param const char *end the end of the buffer
+ * @param Int& x parsed integer, or -1 if it is malformed
+ * @return the next position, or nullptr if there are no more integers
+ */
+template <class Int>
+inline const char *parse_int(const char *p, const char *end, Int& x) {
+    while (p < end && is_space(*p)) {
+        ++p;
+    }
+    if (p == end) {
+        return nullptr;
+    }
+    // up to digits10 + 1 digits fit in 64 bits unsigned, so the range is checked once at the end
+    const char *begin = p;
+    uint64_t value = 0;
+    do {
+        const unsigned int digit = static_cast<unsigned char>(*p - '0');
+        if (digit > 9) {
+            break;
+        }
+        value = value * 10 + digit;
+        ++p;
+    } while (p < end);
+    bool valid = p > begin && p - begin <= std::numeric_limits<Int>::digits10 + 1
+        && value <= static_cast<uint64_t>(std::numeric_limits<Int>::max());
+    while (p < end && !is_space(*p)) {
+        valid = false;
+        ++p;
+    }
+    x = valid ? static_cast<Int>(value) : -1;
+    return p;
+}
+
+/**
+ * A part of the file which starts and ends at line boundaries
+ */
+struct Chunk {
+    const char *begin;
+    const char *end;
+    long long words;    // the number of words
+    int first_m;        // the first docID
+    int last_m;         // the last docID
+    int first_count;    // the number of words of first_m in this chunk
+    bool sorted;        // if docIDs are sorted
+    bool valid;         // if all the IDs are in range
+};
+
+}
+
+/**
+ * Magic number of the binary corpus format
+ */
+static const char corpus_magic[8] = "LDACORP";
+static const uint32_t corpus_version = 1;
+
+/**
+ * Read a vocabulary
  *
  * @param const char *filename open *filename
+ * @param std::vector<std::string>& vocab output, words in the order of wordIDs
  */
-void DataSet::loadDataSet(const char *filename) {
+static void read_vocabulary(const char *filename, std::vector<std::string>& vocab) {
     std::ifstream fin(filename);
     if (!fin) {
         std::cerr << "Can't open the file: " << filename << std::endl;
         exit(1);
     }
 
-    // the 1st line : the number of docs
-    fin >> M;
-    docs.resize(M);
-    n_m.resize(M, 0);
+    std::string buff;
+    while ( fin >> buff ) {
+        vocab.push_back(buff);
+    }
 
-    // the 2nd line : the number of vocabulary
-    fin >> V;
+    fin.close();
+}
+
+/**
+ * Load a file and Initialize variables
+ *
+ * A binary corpus is detected by its magic number, otherwise the file is read as a text corpus.
+ *
+ * @param const char *filename open *filename
+ */
+void DataSet::loadDataSet(const char *filename) {
+    if (!file.open(filename)) {
+        std::cerr << "Can't open the file: " << filename << std::endl;
+        exit(1);
+    }
+    if (file.size() >= sizeof(corpus_magic)
+            && std::memcmp(file.data(), corpus_magic, sizeof(corpus_magic)) == 0) {
+        loadBinary(filename);
+    } else {
+        loadText(filename);
+        file.close();
+    }
+}
+
+/**
+ * Load a binary corpus
+ *
+ * offsets and words point to the mapped file.
+ *
+ * @param const char *filename the name of the mapped file
+ */
+void DataSet::loadBinary(const char *filename) {
+    CorpusHeader header;
+    if (file.size() < sizeof(header)) {
+        std::cerr << "Invalid header: " << filename << std::endl;
+        exit(1);
+    }
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (header.version != corpus_version) {
+        std::cerr << "Unsupported version " << header.version << ": " << filename << std::endl;
+        exit(1);
+    }
+    if (header.M > INT_MAX || header.V > INT_MAX) {
+        std::cerr << "Too many docs or words in the vocabulary: " << filename << std::endl;
+        exit(1);
+    }
+    // M is bounded, so the size of offsets can't overflow, and N is bounded by the rest of the file
+    const size_t offsets_size = (header.M + 1) * sizeof(int64_t);
+    if (file.size() - sizeof(header) < offsets_size
+            || header.N > (file.size() - sizeof(header) - offsets_size) / sizeof(int32_t)) {
+        std::cerr << "Truncated file: " << filename << std::endl;
+        exit(1);
+    }
+    M = header.M;
+    V = header.V;
+    N = header.N;
+
+    offsets = reinterpret_cast<const int64_t *>(file.data() + sizeof(header));
+    if (offsets[0] != 0 || offsets[M] != N) {
+        std::cerr << "Invalid offsets: " << filename << std::endl;
+        exit(1);
+    }
+    n_m.resize(M);
+    for (int m = 0; m < M; ++m) {
+        if (offsets[m+1] < offsets[m]) {
+            std::cerr << "Invalid offsets: " << filename << std::endl;
+            exit(1);
+        }
+        if (offsets[m+1] - offsets[m] > INT_MAX) {
+            std::cerr << "Too long doc " << m + 1 << ": " << filename << std::endl;
+            exit(1);
+        }
+        n_m[m] = offsets[m+1] - offsets[m];
+    }
+    words = reinterpret_cast<const int *>(offsets + M + 1);
+
+    // the words are read once to be checked like a text corpus
+    for (int64_t n = 0; n < N; ++n) {
+        if (static_cast<unsigned int>(words[n]) >= static_cast<unsigned int>(V)) {
+            std::cerr << "Invalid wordID: " << filename << std::endl;
+            exit(1);
+        }
+    }
+}
+
+/**
+ * Read words ahead
+ *
+ * This is effective only for a binary corpus, whose words are in the mapped file.
+ *
+ * @param const size_t first the first word
+ * @param const size_t last the end of the words
+ */
+void DataSet::prefetch(const size_t first, const size_t last) const {
+    if (file.data() != nullptr && first < last) {
+        const size_t offset = reinterpret_cast<const char *>(words) - file.data();
+        file.prefetch(offset + first * sizeof(int), (last - first) * sizeof(int));
+    }
+}
+
+/**
+ * Drop words which won't be used for a while from memory
+ *
+ * This is effective only for a binary corpus, whose words are in the mapped file.
+ *
+ * @param const size_t first the first word
+ * @param const size_t last the end of the words
+ */
+void DataSet::release(const size_t first, const size_t last) const {
+    if (file.data() != nullptr && first < last) {
+        const size_t offset = reinterpret_cast<const char *>(words) - file.data();
+        file.release(offset + first * sizeof(int), (last - first) * sizeof(int));
+    }
+}
+
+/**
+ * Count the occurrences of each word
+ *
+ * @return the number of times each word occurs
+ */
+std::vector<int64_t> DataSet::frequencies() const {
+    std::vector<int64_t> n_t(V, 0);
+    for (int64_t i = 0; i < N; ++i) {
+        ++n_t[ words[i] ];
+    }
+    return n_t;
+}
+
+/**
+ * Save the corpus in the binary format
+ *
+ * @param const char *filename output file
+ */
+void DataSet::saveBinary(const char *filename) const {
+    std::ofstream fout(filename, std::ios::binary);
+    if (!fout) {
+        std::cerr << "Can't open the file: " << filename << std::endl;
+        exit(1);
+    }
+
+    CorpusHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, corpus_magic, sizeof(corpus_magic));
+    header.version = corpus_version;
+    header.M = M;
+    header.V = V;
+    header.N = N;
+    fout.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+    fout.write(reinterpret_cast<const char *>(offsets), (static_cast<size_t>(M) + 1) * sizeof(int64_t));
+    fout.write(reinterpret_cast<const char *>(words), static_cast<size_t>(N) * sizeof(int32_t));
+
+    if (!fout) {
+        std::cerr << "Can't write the file: " << filename << std::endl;
+        exit(1);
+    }
+}
+
+/**
+ * Write a synthetic corpus in the binary format
+ *
+ * The words are generated while they are written, so a corpus larger than the memory,
+ * e.g. with more than 2^31 words, can be made to check the 64-bit sizes.
+ * There are 16 hidden topics, each of which owns a block of the vocabulary;
+ * a doc mixes two of them, and one word in ten is drawn from the whole vocabulary.
+ *
+ * @param const char *filename output file
+ * @param const int M the number of docs
+ * @param const int V the number of vocabulary, at least 16
+ * @param const int doc_length the number of words of each doc
+ * @param const unsigned int seed seed value
+ */
+void DataSet::saveSynthetic(const char *filename, const int M, const int V, const int doc_length,
+        const unsigned int seed) {
+    std::ofstream fout(filename, std::ios::binary);
+    if (!fout) {
+        std::cerr << "Can't open the file: " << filename << std::endl;
+        exit(1);
+    }
+
+    const int topics = 16;
+    const int block = V / topics;
+    CorpusHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, corpus_magic, sizeof(corpus_magic));
+    header.version = corpus_version;
+    header.M = M;
+    header.V = V;
+    header.N = static_cast<uint64_t>(M) * doc_length;
+    fout.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+    for (int64_t m = 0; m <= M; ++m) {
+        const int64_t offset = m * doc_length;
+        fout.write(reinterpret_cast<const char *>(&offset), sizeof(offset));
+    }
+
+    std::mt19937 gen(seed);
+    std::vector<int32_t> words(doc_length);
+    for (int m = 0; m < M; ++m) {
+        const int first = gen() % topics, second = gen() % topics;
+        for (auto& word : words) {
+            const uint32_t r = gen();
+            if (r % 10 == 0) {
+                word = (r / 10) % V;
+            } else {
+                word = ((r % 2 == 0) ? first : second) * block + (r / 10) % block;
+            }
+        }
+        fout.write(reinterpret_cast<const char *>(words.data()), words.size() * sizeof(int32_t));
+    }
+
+    if (!fout) {
+        std::cerr << "Can't write the file: " << filename << std::endl;
+        exit(1);
+    }
+}
 
+/**
+ * Load a text corpus
+ *
+ * The file is memory-mapped and split into chunks at line boundaries, which are parsed in parallel.
+ * If the docIDs are sorted, as usual, each chunk writes its words directly at their places.
+ * Otherwise the whole file is parsed twice in a single thread.
+ *
+ * @param const char *filename open *filename
+ */
+void DataSet::loadText(const char *filename) {
+    const char *p = file.data();
+    const char *end = p + file.size();
+
+    // the 1st line : the number of docs
+    // the 2nd line : the number of vocabulary
     // the 3rd line : the number of words
-    fin >> N;
+    if ((p = parse_int(p, end, M)) == nullptr || (p = parse_int(p, end, V)) == nullptr
+            || (p = parse_int(p, end, N)) == nullptr || M < 0 || V < 0 || N < 0) {
+        std::cerr << "Invalid header: " << filename << std::endl;
+        exit(1);
+    }
+    n_m.assign(M, 0);
 
-    // the following lines : docID wordID count
-    int m, v, cnt;
-    while ( fin >> m >> v >> cnt ) {
-        for (int i = 0; i < cnt; ++i) {
-            docs[m-1].push_back(v);
-            ++n_m[m-1];
+    /*
+     * Split the following lines, docID wordID count, into chunks
+     */
+    const size_t size = end - p;
+    const unsigned int cores = std::max(1u, std::thread::hardware_concurrency());
+    const unsigned int n_chunks = std::min<size_t>(cores, size / (1 << 20) + 1);
+    std::vector<Chunk> chunks(n_chunks);
+    for (unsigned int c = 0; c < n_chunks; ++c) {
+        const char *b = (c == 0) ? p : chunks[c-1].end;
+        const char *e = (c + 1 == n_chunks) ? end : std::max(b, p + size * (c + 1) / n_chunks);
+        while (e < end && *e != '\n') {
+            ++e;
         }
+        chunks[c].begin = b;
+        chunks[c].end = e;
     }
 
-    fin.close();
+    auto run = [&](std::function<void(Chunk&)> f) {
+        std::vector<std::thread> workers;
+        for (auto& chunk : chunks) {
+            workers.emplace_back(f, std::ref(chunk));
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    };
+
+    /*
+     * 1st pass: count words and check docIDs
+     */
+    run([this](Chunk& chunk) {
+        chunk.words = 0;
+        chunk.first_m = chunk.last_m = 0;
+        chunk.sorted = chunk.valid = true;
+        const char *q = chunk.begin;
+        int m, v, cnt;
+        while ((q = parse_int(q, chunk.end, m)) && (q = parse_int(q, chunk.end, v))
+                && (q = parse_int(q, chunk.end, cnt))) {
+            if (m < 1 || m > M || v < 1 || v > V || cnt < 0) {
+                chunk.valid = false;
+            }
+            if (chunk.first_m == 0) {
+                chunk.first_m = m;
+            }
+            if (m < chunk.last_m) {
+                chunk.sorted = false;
+            }
+            chunk.last_m = m;
+            chunk.words += cnt;
+        }
+    });
+
+    bool sorted = true;
+    long long total = 0;
+    int prev_m = 0;
+    for (const auto& chunk : chunks) {
+        if (!chunk.valid) {
+            std::cerr << "Invalid docID, wordID or count: " << filename << std::endl;
+            exit(1);
+        }
+        if (chunk.words == 0) {
+            continue;
+        }
+        if (!chunk.sorted || chunk.first_m < prev_m) {
+            sorted = false;
+        }
+        prev_m = chunk.last_m;
+        total += chunk.words;
+    }
+    // a doc can exceed INT_MAX only if the whole corpus does. such a corpus takes the unsorted path,
+    // which counts the words of each doc in 64 bits and checks them before the words are allocated.
+    if (total > INT_MAX) {
+        sorted = false;
+    }
+    if (!sorted) {
+        std::vector<int64_t> doc_words(M, 0);
+        int m, v, cnt;
+        for (const char *q = p; (q = parse_int(q, end, m)) && (q = parse_int(q, end, v))
+                && (q = parse_int(q, end, cnt)); ) {
+            doc_words[m-1] += cnt;
+        }
+        for (int i = 0; i < M; ++i) {
+            if (doc_words[i] > INT_MAX) {
+                std::cerr << "Too long doc " << i + 1 << ": " << filename << std::endl;
+                exit(1);
+            }
+            n_m[i] = doc_words[i];
+        }
+    }
+    word_buffer.resize(total);
+    words = word_buffer.data();
+    N = total;
+
+    /*
+     * 2nd pass: put words in their places
+     */
+    if (sorted) {
+        std::vector<long long> pos(n_chunks, 0);
+        for (unsigned int c = 1; c < n_chunks; ++c) {
+            pos[c] = pos[c-1] + chunks[c-1].words;
+        }
+        // the first doc of a chunk may be shared with the previous chunk,
+        // so its count is added after all the threads finish.
+        run([this, &chunks, &pos](Chunk& chunk) {
+            chunk.first_count = 0;
+            if (chunk.words == 0) {
+                return;
+            }
+            int *w = &word_buffer[ pos[&chunk - chunks.data()] ];
+            const char *q = chunk.begin;
+            int m, v, cnt;
+            while ((q = parse_int(q, chunk.end, m)) && (q = parse_int(q, chunk.end, v))
+                    && (q = parse_int(q, chunk.end, cnt))) {
+                w = std::fill_n(w, cnt, v - 1);
+                if (m == chunk.first_m) {
+                    chunk.first_count += cnt;
+                } else {
+                    n_m[m-1] += cnt;
+                }
+            }
+        });
+        for (const auto& chunk : chunks) {
+            if (chunk.words > 0) {
+                n_m[chunk.first_m - 1] += chunk.first_count;
+            }
+        }
+    }
+
+    // offsets
+    offset_buffer.resize(M + 1);
+    offset_buffer[0] = 0;
+    for (int i = 0; i < M; ++i) {
+        offset_buffer[i+1] = offset_buffer[i] + n_m[i];
+    }
+    offsets = offset_buffer.data();
+
+    if (!sorted) {
+        std::vector<int64_t> pos(offsets, offsets + M);
+        int m, v, cnt;
+        for (const char *q = p; (q = parse_int(q, end, m)) && (q = parse_int(q, end, v))
+                && (q = parse_int(q, end, cnt)); ) {
+            std::fill_n(&word_buffer[ pos[m-1] ], cnt, v - 1);
+            pos[m-1] += cnt;
+        }
+    }
 }
 
 /**
@@ -83,16 +530,196 @@ void DataSet::loadDataSet(const char *filename) {
  * @param const char *filename open *filename
  */
 void DataSet::loadVocabulary(const char *filename) {
-    std::ifstream fin(filename);
+    read_vocabulary(filename, vocab);
+}
+
+/**
+ * Constructor
+ *
+ * Open a corpus and Load Vocabulary
+ *
+ * @param const char *dataset DataSet's filename
+ * @param const char *vocab Vocabulary's filename
+ */
+DocStream::DocStream(const char *dataset, const char *_vocab)
+    :M(0), V(0), N(0), filename(dataset), binary(false), m(0), offset(0), doc(-1), word(0), count(0)
+{
+    open();
+    read_vocabulary(_vocab, vocab);
+}
+
+/**
+ * Open the corpus and Read its header
+ */
+void DocStream::open() {
+    fin.close();
+    fin.clear();
+    fin.open(filename, std::ios::binary);
     if (!fin) {
         std::cerr << "Can't open the file: " << filename << std::endl;
         exit(1);
     }
 
-    std::string buff;
-    while ( fin >> buff ) {
-        vocab.push_back(buff);
+    CorpusHeader header;
+    fin.read(reinterpret_cast<char *>(&header), sizeof(header));
+    binary = fin && std::memcmp(header.magic, corpus_magic, sizeof(corpus_magic)) == 0;
+    if (binary) {
+        if (header.version != corpus_version) {
+            std::cerr << "Unsupported version " << header.version << ": " << filename << std::endl;
+            exit(1);
+        }
+        if (header.M > INT_MAX || header.V > INT_MAX) {
+            std::cerr << "Too many docs or words in the vocabulary: " << filename << std::endl;
+            exit(1);
+        }
+        // M is bounded, so the size of offsets can't overflow, and N is bounded by the rest of the file
+        fin.seekg(0, std::ios::end);
+        const size_t file_size = fin.tellg();
+        const size_t offsets_size = (header.M + 1) * sizeof(int64_t);
+        if (file_size - sizeof(header) < offsets_size
+                || header.N > (file_size - sizeof(header) - offsets_size) / sizeof(int32_t)) {
+            std::cerr << "Truncated file: " << filename << std::endl;
+            exit(1);
+        }
+        M = header.M;
+        V = header.V;
+        N = header.N;
+        fin.seekg(sizeof(header));
+        fin.read(reinterpret_cast<char *>(&offset), sizeof(offset));
+        if (offset != 0) {
+            std::cerr << "Invalid offsets: " << filename << std::endl;
+            exit(1);
+        }
+        fin_words.close();
+        fin_words.clear();
+        fin_words.open(filename, std::ios::binary);
+        fin_words.seekg(sizeof(header) + (header.M + 1) * sizeof(int64_t));
+    } else {
+        fin.clear();
+        fin.seekg(0);
+        if (!(fin >> M >> V >> N) || M < 0 || V < 0 || N < 0) {
+            std::cerr << "Invalid header: " << filename << std::endl;
+            exit(1);
+        }
+        read_ahead();
     }
+    m = 0;
+}
 
-    fin.close();
+/**
+ * Read the next line, docID wordID count, of a text corpus
+ *
+ * doc is 0-origin, and -1 at the end of the file.
+ */
+void DocStream::read_ahead() {
+    if (!(fin >> doc >> word >> count)) {
+        doc = -1;
+        return;
+    }
+    if (doc < 1 || doc > M || word < 1 || word > V || count < 1) {
+        std::cerr << "Invalid docID, wordID or count: " << filename << std::endl;
+        exit(1);
+    }
+    --doc;
+}
+
+/**
+ * Rewind to the first doc
+ */
+void DocStream::rewind() {
+    open();
+}
+
+/**
+ * Read the next batch
+ *
+ * @param const int batch_size the maximum number of docs
+ * @param std::vector<int>& words output, words of the docs (0-origin)
+ * @param std::vector<int>& counts output, counts of words
+ * @param std::vector<int>& offsets output, the bag of words of the dth doc is in [offsets[d], offsets[d+1])
+ * @return false if there are no more docs
+ */
+bool DocStream::next(const int batch_size, std::vector<int>& words, std::vector<int>& counts,
+        std::vector<int>& offsets) {
+    words.clear();
+    counts.clear();
+    offsets.assign(1, 0);
+
+    if (binary) {
+        const int docs = std::min(batch_size, M - m);
+        for (int d = 0; d < docs; ++d) {
+            int64_t next_offset;
+            fin.read(reinterpret_cast<char *>(&next_offset), sizeof(next_offset));
+            if (!fin) {
+                std::cerr << "Truncated file: " << filename << std::endl;
+                exit(1);
+            }
+            if (next_offset < offset || next_offset > N || (m + d + 1 == M && next_offset != N)) {
+                std::cerr << "Invalid offsets: " << filename << std::endl;
+                exit(1);
+            }
+            if (next_offset - offset > INT_MAX) {
+                std::cerr << "Too long doc " << m + d + 1 << ": " << filename << std::endl;
+                exit(1);
+            }
+            tokens.resize(next_offset - offset);
+            fin_words.read(reinterpret_cast<char *>(tokens.data()), tokens.size() * sizeof(int));
+            if (!fin_words) {
+                std::cerr << "Truncated file: " << filename << std::endl;
+                exit(1);
+            }
+            for (const int v : tokens) {
+                if (static_cast<unsigned int>(v) >= static_cast<unsigned int>(V)) {
+                    std::cerr << "Invalid wordID: " << filename << std::endl;
+                    exit(1);
+                }
+            }
+            count_words(tokens.data(), tokens.data() + tokens.size(), words, counts);
+            offsets.push_back(words.size());
+            offset = next_offset;
+        }
+        m += docs;
+        return docs > 0;
+    }
+
+    // text, whose docs without words are skipped
+    int docs = 0;
+    while (doc >= 0 && docs < batch_size) {
+        const int current = doc;
+        while (doc == current) {
+            words.push_back(word - 1);
+            counts.push_back(count);
+            read_ahead();
+        }
+        if (doc >= 0 && doc < current) {
+            std::cerr << "docIDs must be sorted to stream the file: " << filename << std::endl;
+            exit(1);
+        }
+        offsets.push_back(words.size());
+        ++docs;
+    }
+    return docs > 0;
+}
+
+/**
+ * Convert words into a bag of words
+ *
+ * @param const int *first the first word
+ * @param const int *last the end of the words
+ * @param std::vector<int>& words output, distinct words are appended
+ * @param std::vector<int>& counts output, their counts are appended
+ */
+void DocStream::count_words(const int *first, const int *last, std::vector<int>& words,
+        std::vector<int>& counts) {
+    std::vector<int> sorted(first, last);
+    std::sort(begin(sorted), end(sorted));
+    for (size_t i = 0; i < sorted.size(); ) {
+        size_t j = i;
+        while (j < sorted.size() && sorted[j] == sorted[i]) {
+            ++j;
+        }
+        words.push_back(sorted[i]);
+        counts.push_back(j - i);
+        i = j;
+    }
 }
@@ -19,21 +19,104 @@
 #include <fstream>
 #include <vector>
 #include <string>
+#include <algorithm>
+#include <functional>
+#include <thread>
+#include <chrono>
+#include <cstring>
+#include <cstdint>
+#include <climits>
+#include <limits>
+#include <random>
+#include "MappedFile.hpp"
 
+/**
+ * Header of the binary corpus format
+ *
+ * The header is followed by
+ *   int64_t offsets[M + 1]
+ *   int32_t words[N] (0-origin)
+ * in the native byte order.
+ */
+struct CorpusHeader {
+    char magic[8];      // "LDACORP"
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t M;
+    uint64_t V;
+    uint64_t N;
+};
+
+/**
+ * Bag-of-words corpus in CSR format
+ *
+ * The words of the m-th doc are words[offsets[m]], ..., words[offsets[m+1] - 1].
+ * Word ids are 0-origin, i.e. wordID - 1 in the file.
+ * A binary corpus made by corpus2bin is memory-mapped and its offsets and words are used without copying.
+ * N and offsets are 64-bit, so a corpus may have more than 2^31 words,
+ * while M, V and the length of each doc must fit in int.
+ */
 struct DataSet {
-    std::vector<std::vector<int>> docs;
+    const int *words;
+    const int64_t *offsets;     // M + 1 offsets
     std::vector<std::string> vocab;
     std::vector<int> n_m;
     int M;
     int V;
-    int N;
+    int64_t N;          // the number of words
+    double load_time;   // seconds
 
     DataSet(const char *dataset);
     DataSet(const char *dataset, const char *vocab);
     virtual ~DataSet() = default;
+    void saveBinary(const char *filename) const;
+    static void saveSynthetic(const char *filename, const int M, const int V, const int doc_length,
+            const unsigned int seed);
+    void prefetch(const size_t first, const size_t last) const;
+    void release(const size_t first, const size_t last) const;
+    std::vector<int64_t> frequencies() const;
 private:
+    std::vector<int> word_buffer;   // words of a text corpus
+    std::vector<int64_t> offset_buffer; // offsets of a text corpus
+    MappedFile file;                // a binary corpus
     void loadDataSet(const char *filename);
+    void loadText(const char *filename);
+    void loadBinary(const char *filename);
     void loadVocabulary(const char *filename);
 };
 
+/**
+ * Corpus read sequentially, a batch of docs at a time
+ *
+ * Only the current batch is kept in memory, so that a corpus larger than memory can be streamed.
+ * Each doc is a bag of words, i.e. pairs of a word (0-origin) and its count.
+ * The docIDs of a text corpus must be sorted.
+ */
+class DocStream {
+public:
+    std::vector<std::string> vocab;
+    int M;
+    int V;
+    int64_t N;          // the number of words
+
+    DocStream(const char *dataset, const char *vocab);
+    virtual ~DocStream() = default;
+    bool next(const int batch_size, std::vector<int>& words, std::vector<int>& counts,
+            std::vector<int>& offsets);
+    void rewind();
+    static void count_words(const int *first, const int *last, std::vector<int>& words,
+            std::vector<int>& counts);
+private:
+    std::string filename;
+    bool binary;
+    std::ifstream fin;          // a text corpus, or offsets of a binary corpus
+    std::ifstream fin_words;    // words of a binary corpus
+    int m;                      // the next doc
+    int64_t offset;             // the offset of the next doc in a binary corpus
+    int doc, word, count;       // the line read ahead in a text corpus, doc < 0 if none
+    std::vector<int> tokens;
+    void open();
+    void read_ahead();
+};
+
 #endif
@@ -34,7 +34,9 @@ HdpLda::HdpLda(const double _alpha, const double _alpha_a, const double _alpha_b
         const double _gamma, const double _gamma_a, const double _gamma_b, const unsigned int _K,
         const unsigned int _seed, const char *train, const char *test, const char *vocab)
     :dataset(train, vocab), testset(test), alpha(_alpha), alpha_a(_alpha_a), alpha_b(_alpha_b),
-    beta(_beta), gamma(_gamma), gamma_a(_gamma_a), gamma_b(_gamma_b), K(_K), m(0), gen(_seed)
+    beta(_beta), gamma(_gamma), gamma_a(_gamma_a), gamma_b(_gamma_b), K(_K), m(0), gen(_seed),
+    sampler(Sampler::Dense), s_sum(0.0), r_sum(0.0), threads(1), next_dish(0),
+    checkpoint_interval(0), first_iteration(0)
 {
     init_vars();
 }
@@ -46,12 +48,9 @@ void HdpLda::init_vars() {
     // tables
     tables.resize(dataset.M);
 
-    // t_j_i
-    t_j_i.resize(dataset.M);
-    for (int j = 0; j < dataset.M; ++j) {
-        // -1 means not assigned
-        t_j_i[j].resize(dataset.n_m[j], -1);
-    }
+    // t_n
+    // -1 means not assigned
+    t_n.resize(dataset.N, -1);
 
     // n_j_t
     n_j_t.resize(dataset.M);
@@ -63,9 +62,6 @@ void HdpLda::init_vars() {
     n_j_t_v.resize(dataset.M);
     for (auto& n_t_v : n_j_t_v) {
         n_t_v.resize(1);
-        for (auto& n_v : n_t_v) {
-            n_v.resize(dataset.V, 0);
-        }
     }
 
     // if K == 0, _K is initialised for the initialization of CRF sampling scheme,
@@ -76,10 +72,7 @@ void HdpLda::init_vars() {
     n_k.resize(_K);
 
     // n_k_v
-    n_k_v.resize(_K);
-    for (auto& n_v : n_k_v) {
-        n_v.resize(dataset.V);
-    }
+    n_k_v.init(dataset.frequencies(), _K);
 
     // m_k
     m_k.resize(_K);
@@ -92,6 +85,48 @@ void HdpLda::init_vars() {
 
     // theta
     theta_j_k.resize(dataset.M);
+
+    init_free_lists();
+    init_lgamma();
+}
+
+/**
+ * Tabulate lgamma(beta + n) and lgamma(V * beta + n)
+ *
+ * n_kv never exceeds the frequency of v, and n_k never exceeds N,
+ * so the tables cover every count of a small corpus; larger counts fall back to std::lgamma.
+ */
+void HdpLda::init_lgamma() {
+    const int64_t limit = 1 << 20;
+    const auto n_v = dataset.frequencies();
+    const int64_t max_n_v = n_v.empty() ? 0 : *std::max_element(n_v.begin(), n_v.end());
+
+    lgamma_beta.resize(std::min(max_n_v + 1, limit));
+    for (size_t n = 0; n < lgamma_beta.size(); ++n) {
+        lgamma_beta[n] = std::lgamma(beta + n);
+    }
+    lgamma_Vbeta.resize(std::min(dataset.N + 1, limit));
+    for (size_t n = 0; n < lgamma_Vbeta.size(); ++n) {
+        lgamma_Vbeta[n] = std::lgamma(dataset.V * beta + n);
+    }
+}
+
+/**
+ * Log of the rising factorial (x + n)(x + n + 1)...(x + n + c - 1)
+ *
+ * This is lgamma(x + n + c) - lgamma(x + n), which takes no loop over c.
+ *
+ * @param const std::vector<double>& lgamma_x lgamma_x[i] = lgamma(x + i) for small i
+ * @param const double x the real part
+ * @param const int64_t n the integer part
+ * @param const int c the number of factors
+ * @return log of the rising factorial
+ */
+double HdpLda::log_rising(const std::vector<double>& lgamma_x, const double x, const int64_t n, const int c) const {
+    const int64_t size = lgamma_x.size();
+    const double first = (n < size) ? lgamma_x[n] : std::lgamma(x + n);
+    const double last = (n + c < size) ? lgamma_x[n + c] : std::lgamma(x + n + c);
+    return last - first;
 }
 
 /**
@@ -111,49 +146,274 @@ void HdpLda::assign_random_topic() {
 
         // initialize variables
         tables[j].resize(K);
-        t_j_i[j].reserve(dataset.n_m[j]);
         n_j_t[j].resize(K);
         n_j_t_v[j].resize(K);
-        for (auto& n_v : n_j_t_v[j]) {
-            n_v.resize(dataset.V);
-        }
 
         // assign a table
         for (int i = 0; i < dataset.n_m[j]; ++i) {
+            const int64_t n = dataset.offsets[j] + i;
             const int t = dist(gen);
-            const int v = dataset.docs[j][i] - 1;
+            const int v = dataset.words[n];
             const int k = k_j_t[j][t];
 
-            t_j_i[j][i]     = t;
+            t_n[n]          = t;
             tables[j][t]    = 1;
             dishes[k]       = 1;
 
             ++n_j_t[j][t];
-            ++n_j_t_v[j][t][v];
+            n_j_t_v[j][t].add(v, 1);
             ++n_k[k];
-            ++n_k_v[k][v];
+            n_k_v.add(v, k, 1);
         }
-        m += count_tables(j);
-
         for (unsigned int t = 0; t < tables[j].size(); ++t) {
             if (tables[j][t] == 1) {
                 const int k = k_j_t[j][t];
+                ++m;
                 ++m_k[k];
             }
         }
     }
+
+    init_free_lists();
+}
+
+/**
+ * Collect the unused tables and dishes
+ *
+ * They are pushed in descending order, so the lowest ones are reused first.
+ */
+void HdpLda::init_free_lists() {
+    free_tables.resize(dataset.M);
+    for (int j = 0; j < dataset.M; ++j) {
+        free_tables[j].clear();
+        for (int t = tables[j].size() - 1; t >= 0; --t) {
+            if (tables[j][t] == 0) {
+                free_tables[j].push_back(t);
+            }
+        }
+    }
+    free_dishes.clear();
+    for (int k = dishes.size() - 1; k >= 0; --k) {
+        if (dishes[k] == 0) {
+            free_dishes.push_back(k);
+        }
+    }
+}
+
+/**
+ * Select a seating sampler
+ *
+ * Sampler::Dense evaluates all K dishes for every word and is the reference implementation.
+ * Sampler::Sparse divides the mass into buckets like SparseLDA, and draws from the same conditional distribution.
+ *
+ * @param const Sampler _sampler sampling algorithm
+ */
+void HdpLda::set_sampler(const Sampler _sampler) {
+    sampler = _sampler;
+}
+
+/**
+ * Set the number of threads
+ *
+ * If more than one thread is used, inference() runs approximate parallel sampling with the dense sampler.
+ *
+ * @param const unsigned int _threads the number of threads
+ */
+void HdpLda::set_threads(const unsigned int _threads) {
+    threads = (_threads == 0) ? 1 : _threads;
+}
+
+/**
+ * Write checkpoints periodically
+ *
+ * @param const char *filename checkpoint file
+ * @param const unsigned int interval write a checkpoint every interval iterations
+ */
+void HdpLda::set_checkpoint(const char *filename, const unsigned int interval) {
+    checkpoint_file = filename;
+    checkpoint_interval = interval;
+}
+
+/**
+ * Write a checkpoint
+ *
+ * The seating arrangement, i.e. t_ji, k_jt and the using tables and dishes, the hyperparameters
+ * and the state of the random number generator are copied into a snapshot, which is written in the background.
+ * The counters are not saved since they are recounted from the seating arrangement.
+ *
+ * @param const unsigned int iteration the number of iterations done
+ */
+void HdpLda::checkpoint(const unsigned int iteration) {
+    checkpoint_writer.begin(Model::HDP_LDA, iteration, dataset);
+    checkpoint_writer.put(alpha);
+    checkpoint_writer.put(beta);
+    checkpoint_writer.put(gamma);
+    checkpoint_writer.put(dishes);
+    checkpoint_writer.put(free_dishes);
+    checkpoint_writer.put(tables);
+    checkpoint_writer.put(free_tables);
+    checkpoint_writer.put(k_j_t);
+    checkpoint_writer.put(t_n);
+    checkpoint_writer.put(gen);
+    checkpoint_writer.commit(checkpoint_file);
+}
+
+/**
+ * Resume from a checkpoint
+ *
+ * In one thread, the resumed chain is identical to the uninterrupted one.
+ * Otherwise the generators of the threads are seeded again, so the chain continues from the same state but with different draws.
+ *
+ * @param const char *filename checkpoint file
+ */
+void HdpLda::resume(const char *filename) {
+    CheckpointReader reader;
+    reader.open(filename, Model::HDP_LDA, dataset);
+    reader.get(alpha);
+    reader.get(beta);
+    reader.get(gamma);
+    reader.get(dishes);
+    reader.get(free_dishes);
+    reader.get(tables);
+    reader.get(free_tables);
+    reader.get(k_j_t);
+    reader.get(t_n);
+    reader.get(gen);
+    first_iteration = reader.header.iteration;
+    K = dishes.size();
+    if (!valid_state()) {
+        std::cerr << "Invalid checkpoint: " << filename << std::endl;
+        exit(1);
+    }
+    init_lgamma();
+
+    /*
+     * Recount
+     */
+    m = 0;
+    m_k.assign(K, 0);
+    n_k.assign(K, 0);
+    n_k_v.init(dataset.frequencies(), K);
+    for (int j = 0; j < dataset.M; ++j) {
+        const int T = tables[j].size();
+        n_j_t[j].assign(T, 0);
+        n_j_t_v[j].assign(T, WordHistogram());
+        for (int t = 0; t < T; ++t) {
+            if (tables[j][t] == 1) {
+                ++m;
+                ++m_k[k_j_t[j][t]];
+            }
+        }
+        for (int64_t n = dataset.offsets[j]; n < dataset.offsets[j+1]; ++n) {
+            const int t = t_n[n];
+            const int v = dataset.words[n];
+            const int k = k_j_t[j][t];
+            ++n_j_t[j][t];
+            n_j_t_v[j][t].add(v, 1);
+            ++n_k[k];
+            n_k_v.add(v, k, 1);
+        }
+    }
+}
+
+/**
+ * Check the restored tables and dishes
+ *
+ * Every ID must fit the restored vectors, the free lists must hold each unused table and dish once,
+ * and a dish must be used if and only if it is served at some table.
+ *
+ * @return true if the state is consistent
+ */
+bool HdpLda::valid_state() const {
+    const size_t M = dataset.M;
+    if (tables.size() != M || free_tables.size() != M || k_j_t.size() != M
+            || t_n.size() != static_cast<size_t>(dataset.N)) {
+        return false;
+    }
+
+    // dishes
+    std::vector<char> freed(K, 0);
+    for (const int k : free_dishes) {
+        if (k < 0 || k >= K || dishes[k] != 0 || freed[k]) {
+            return false;
+        }
+        freed[k] = 1;
+    }
+    if (free_dishes.size() != static_cast<size_t>(std::count(dishes.begin(), dishes.end(), 0))) {
+        return false;
+    }
+    std::vector<char> served(K, 0);
+
+    // tables
+    for (size_t j = 0; j < M; ++j) {
+        const int T = tables[j].size();
+        if (k_j_t[j].size() != tables[j].size()) {
+            return false;
+        }
+        freed.assign(T, 0);
+        for (const int t : free_tables[j]) {
+            if (t < 0 || t >= T || tables[j][t] != 0 || freed[t]) {
+                return false;
+            }
+            freed[t] = 1;
+        }
+        if (free_tables[j].size() != static_cast<size_t>(std::count(tables[j].begin(), tables[j].end(), 0))) {
+            return false;
+        }
+        for (int t = 0; t < T; ++t) {
+            // an unused table keeps a dish in range too, since sampling_t reads f_k of every table
+            const int k = k_j_t[j][t];
+            if ((tables[j][t] != 0 && tables[j][t] != 1) || k < 0 || k >= K
+                    || (tables[j][t] == 1 && dishes[k] != 1)) {
+                return false;
+            }
+            if (tables[j][t] == 1) {
+                served[k] = 1;
+            }
+        }
+        for (int64_t n = dataset.offsets[j]; n < dataset.offsets[j+1]; ++n) {
+            if (t_n[n] < 0 || t_n[n] >= T || tables[j][ t_n[n] ] != 1) {
+                return false;
+            }
+        }
+    }
+    for (int k = 0; k < K; ++k) {
+        if ((dishes[k] != 0 && dishes[k] != 1) || (dishes[k] == 1) != (served[k] == 1)) {
+            return false;
+        }
+    }
+    return true;
 }
 
 /**
  * Inference
  */
 void HdpLda::inference() {
+    if (threads > 1) {
+        inference_parallel();
+        if (!free_dishes.empty()) {
+            compact_dishes();
+        }
+        return;
+    }
+
     /*
      * sampling t_ji
      */
-    for (int j = 0; j < dataset.M; ++j) {
-        for (int i = 0; i < dataset.n_m[j]; ++i) {
-            sampling_t(j, i);
+    if (sampler == Sampler::Sparse) {
+        init_sparse();
+        for (int j = 0; j < dataset.M; ++j) {
+            begin_doc_sparse(j);
+            for (int i = 0; i < dataset.n_m[j]; ++i) {
+                sampling_t_sparse(j, i);
+            }
+            end_doc_sparse(j);
+        }
+    } else {
+        for (int j = 0; j < dataset.M; ++j) {
+            for (int i = 0; i < dataset.n_m[j]; ++i) {
+                sampling_t(j, i, n_k, n_k_v, m_k, m, gen, dense_buffer);
+            }
         }
     }
 
@@ -163,64 +423,210 @@ void HdpLda::inference() {
     for (int j = 0; j < dataset.M; ++j) {
         for (unsigned int t = 0; t < tables[j].size(); ++t) {
             if (tables[j][t] == 1) {
-                sampling_k(j, t);
+                sampling_k(j, t, n_k, n_k_v, m_k, m, gen, dense_buffer);
             }
         }
     }
+
+    if (!free_dishes.empty()) {
+        compact_dishes();
+    }
+}
+
+/**
+ * Initialize approximate parallel sampling
+ *
+ * Docs are divided into contiguous shards which have almost the same number of words.
+ *
+ * @see David Newman, Arthur Asuncion, Padhraic Smyth, and Max Welling. Distributed algorithms for topic models. JMLR, 10:1801-1828, 2009.
+ */
+void HdpLda::init_parallel() {
+    // shards
+    shards.assign(1, 0);
+    long long words = 0;
+    for (int j = 0; j < dataset.M; ++j) {
+        words += dataset.n_m[j];
+        if (words * threads >= static_cast<long long>(dataset.N) * static_cast<long long>(shards.size())
+                && shards.size() < threads) {
+            shards.push_back(j + 1);
+        }
+    }
+    while (shards.size() <= threads) {
+        shards.push_back(dataset.M);
+    }
+
+    // replicas
+    replicas.resize(threads);
+    for (auto& replica : replicas) {
+        replica.gen.seed(gen());
+    }
+}
+
+/**
+ * Inference by approximate parallel sampling
+ *
+ * Each thread samples t_ji and k_jt of its own shard against a replica of n_k, n_kv, m_k and m,
+ * and then the differences of the replicas are merged into the global counts.
+ * The restaurants of a shard are touched by its thread only, so they need no merge.
+ */
+void HdpLda::inference_parallel() {
+    if (replicas.size() != threads) {
+        init_parallel();
+    }
+    next_dish = K;
+
+    // sampling
+    std::vector<std::thread> workers;
+    for (unsigned int i = 0; i < threads; ++i) {
+        workers.emplace_back([this, i]() {
+            auto& replica = replicas[i];
+            replica.n_k = n_k;
+            replica.n_k_v = n_k_v;
+            replica.m_k = m_k;
+            replica.m = m;
+            for (int j = shards[i]; j < shards[i+1]; ++j) {
+                for (int n = 0; n < dataset.n_m[j]; ++n) {
+                    sampling_t(j, n, replica.n_k, replica.n_k_v, replica.m_k, replica.m, replica.gen, replica.buffer);
+                }
+            }
+            for (int j = shards[i]; j < shards[i+1]; ++j) {
+                for (unsigned int t = 0; t < tables[j].size(); ++t) {
+                    if (tables[j][t] == 1) {
+                        sampling_k(j, t, replica.n_k, replica.n_k_v, replica.m_k, replica.m, replica.gen, replica.buffer);
+                    }
+                }
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    workers.clear();
+
+    /*
+     * reconciliation
+     */
+    // n_k, m_k and m
+    const int old_size = n_k.size();
+    const int new_size = std::max<int>(next_dish, old_size);
+    n_k.resize(new_size);
+    m_k.resize(new_size);
+    const int64_t old_m = m;
+    for (int k = 0; k < new_size; ++k) {
+        const int64_t old_n_k = n_k[k];
+        const int64_t old_m_k = m_k[k];
+        for (const auto& replica : replicas) {
+            if (k < static_cast<int>(replica.n_k.size())) {
+                n_k[k] += replica.n_k[k] - old_n_k;
+                m_k[k] += replica.m_k[k] - old_m_k;
+            }
+        }
+    }
+    for (const auto& replica : replicas) {
+        m += replica.m - old_m;
+    }
+
+    // n_kv
+    n_k_v.resize(new_size);
+    for (unsigned int i = 0; i < threads; ++i) {
+        workers.emplace_back([this, i, new_size]() {
+            const long long V = dataset.V;
+            std::vector<int> n_k_of_v(new_size, 0);
+            for (int v = V * i / threads; v < V * (i + 1) / threads; ++v) {
+                n_k_v.load(v, n_k_of_v.data(), 1 - static_cast<int>(threads));
+                for (const auto& replica : replicas) {
+                    replica.n_k_v.load(v, n_k_of_v.data());
+                }
+                n_k_v.store(v, n_k_of_v.data());
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    // dishes
+    // a dish left with no tables is removed here, and dropped by compact_dishes()
+    K = next_dish;
+    dishes.resize(K);
+    for (int k = 0; k < K; ++k) {
+        dishes[k] = (m_k[k] > 0) ? 1 : 0;
+    }
+    free_dishes.clear();
+    for (int k = K - 1; k >= 0; --k) {
+        if (dishes[k] == 0) {
+            free_dishes.push_back(k);
+        }
+    }
 }
 
 /**
  * Sampling t_ji
  *
+ * The dishes are those of _n_k, which may have more dishes than K in a replica.
+ *
  * @param const int j the j-th doc(restaurant)
  * @param const int i the i-th word(guest) in the j-th doc(restaurant)
+ * @param std::vector<int64_t>& _n_k n_k to be used
+ * @param TopicWordCounts& _n_k_v n_kv to be used
+ * @param std::vector<int64_t>& _m_k m_k to be used
+ * @param int64_t& _m m to be used
+ * @param std::mt19937& _gen random number generator to be used
+ * @param DenseBuffer& _buffer buffers to be used
  */
-void HdpLda::sampling_t(const int j, const int i) {
-    const int old_t = t_j_i[j][i];
-    const int old_k = k_j_t[j][old_t];
-    const int v = dataset.docs[j][i] - 1;
+void HdpLda::sampling_t(const int j, const int i, std::vector<int64_t>& _n_k, TopicWordCounts& _n_k_v,
+        std::vector<int64_t>& _m_k, int64_t& _m, std::mt19937& _gen, DenseBuffer& _buffer) {
+    const int64_t n = dataset.offsets[j] + i;
+    const int old_t = t_n[n];
+    const int v = dataset.words[n];
 
     /*
      * Decrease counters
      */
     if (old_t >= 0) {
-        --n_k[old_k];
-        --n_k_v[old_k][v];
+        const int old_k = k_j_t[j][old_t];
+        --_n_k[old_k];
+        _n_k_v.add(v, old_k, -1);
         --n_j_t[j][old_t];
-        --n_j_t_v[j][old_t][v];
+        n_j_t_v[j][old_t].add(v, -1);
 
         if (n_j_t[j][old_t] == 0) {
-            remove_table(j, old_t);
+            remove_table(j, old_t, _m_k, _m);
         }
     }
 
     /*
      * Sampling
      */
+    const int _K = _n_k.size();
+    auto& f_k = _buffer.f_k;
     // f_k
-    std::vector<double> f_k(K);
-    for (int k = 0; k < K; ++k) {
-        f_k[k] = (beta + n_k_v[k][v]) / (dataset.V * beta + n_k[k]);
+    f_k.resize(_K);
+    for (int k = 0; k < _K; ++k) {
+        f_k[k] = beta / (dataset.V * beta + _n_k[k]);
     }
+    _n_k_v.for_each(v, [&](const int k, const int n_kv) {
+        f_k[k] = (beta + n_kv) / (dataset.V * beta + _n_k[k]);
+    });
 
     // p_x
     double p_x = 0.0;
-    for (int k = 0; k < K; ++k) {
-            p_x += m_k[k] * f_k[k];
+    for (int k = 0; k < _K; ++k) {
+            p_x += _m_k[k] * f_k[k];
     }
     p_x += gamma / dataset.V;
-    p_x /= gamma + m;
+    p_x /= gamma + _m;
 
     // p_t
-    std::vector<double> p_t(tables[j].size() + 1);
-    for (unsigned int t = 0; t < tables[j].size(); ++t) {
+    const int T = tables[j].size();
+    double *p_t = _buffer.dis_t.weights(T + 1);
+    for (int t = 0; t < T; ++t) {
         p_t[t] = n_j_t[j][t] * f_k[ k_j_t[j][t] ];
     }
-    p_t[tables[j].size()] = alpha * p_x;
+    p_t[T] = alpha * p_x;
 
     // sampling
-    std::discrete_distribution<> dis_p_t(begin(p_t), end(p_t));
-    unsigned int new_t = dis_p_t(gen);
+    unsigned int new_t = _buffer.dis_t(T + 1, _gen);
 
     // new_t == t^new
     if (new_t  == tables[j].size()) {
@@ -228,49 +634,259 @@ void HdpLda::sampling_t(const int j, const int i) {
          * Sampling k_jt^new
          */
         // p_k_jt^new
-        std::vector<double> p_k(K+1);
-        for (int k = 0; k < K; ++k) {
-            p_k[k] = m_k[k] * f_k[k];
+        double *p_k = _buffer.dis_k.weights(_K + 1);
+        for (int k = 0; k < _K; ++k) {
+            p_k[k] = _m_k[k] * f_k[k];
         }
-        p_k[K] = gamma / dataset.V;
+        p_k[_K] = gamma / dataset.V;
 
         // sampling
-        std::discrete_distribution<> dis_p_k(begin(p_k), end(p_k));
-        int new_k = dis_p_k(gen);
+        int new_k = _buffer.dis_k(_K + 1, _gen);
 
         // new_k == k^new
-        if (new_k == K) {
-            new_k = assign_new_dish();
+        if (new_k == _K) {
+            new_k = assign_new_dish(_n_k, _n_k_v, _m_k);
         }
 
-        new_t = add_new_table(j, new_k);
+        new_t = add_new_table(j, new_k, _m_k, _m);
     }
 
     /*
      * Update and Increase counters
      */
     const int new_k = k_j_t[j][new_t];
-    t_j_i[j][i] = new_t;
+    t_n[n] = new_t;
+    ++n_j_t[j][new_t];
+    ++_n_k[new_k];
+    _n_k_v.add(v, new_k, 1);
+    n_j_t_v[j][new_t].add(v, 1);
+}
+
+/**
+ * Initialize the buckets of the sparse seating sampler
+ *
+ * n_k and m_k have been changed by sampling k_jt, so the cached values are recomputed at every sweep.
+ */
+void HdpLda::init_sparse() {
+    const double Vbeta = dataset.V * beta;
+
+    s_sum = 0.0;
+    inv_denom_k.resize(K);
+    n_k_of_j.assign(K, 0);
+    for (int k = 0; k < K; ++k) {
+        inv_denom_k[k] = 1.0 / (n_k[k] + Vbeta);
+        s_sum += beta * m_k[k] * inv_denom_k[k];
+    }
+}
+
+/**
+ * Set up the restaurant bucket for the j-th doc
+ *
+ * @param const int j the j-th doc(restaurant)
+ */
+void HdpLda::begin_doc_sparse(const int j) {
+    r_sum = 0.0;
+    for (unsigned int t = 0; t < tables[j].size(); ++t) {
+        if (tables[j][t] == 1) {
+            const int k = k_j_t[j][t];
+            n_k_of_j[k] += n_j_t[j][t];
+            r_sum += beta * n_j_t[j][t] * inv_denom_k[k];
+        }
+    }
+}
+
+/**
+ * Clear n_jk of the j-th doc
+ *
+ * @param const int j the j-th doc(restaurant)
+ */
+void HdpLda::end_doc_sparse(const int j) {
+    for (unsigned int t = 0; t < tables[j].size(); ++t) {
+        if (tables[j][t] == 1) {
+            n_k_of_j[ k_j_t[j][t] ] = 0;
+        }
+    }
+}
+
+/**
+ * Sampling t_ji by buckets
+ *
+ * With f_k = (beta + n_kv) / (n_k + V * beta), the mass of the existing tables is divided into
+ *   n_jk * beta / (n_k + V * beta)                           (restaurant)
+ *   n_jk * n_kv / (n_k + V * beta)                           (table-word)
+ * and that of a new table, alpha / (gamma + m) times, into
+ *   m_k * beta / (n_k + V * beta)                            (smoothing-only)
+ *   m_k * n_kv / (n_k + V * beta)                            (dish-word)
+ *   gamma / V                                                (new dish)
+ * The word buckets are evaluated only for the dishes s.t. n_kv > 0,
+ * and the others are kept up to date as the counters change.
+ * A table is drawn from the tables of the chosen dish in proportion to n_jt.
+ *
+ * @param const int j the j-th doc(restaurant)
+ * @param const int i the i-th word(guest) in the j-th doc(restaurant)
+ */
+void HdpLda::sampling_t_sparse(const int j, const int i) {
+    const double Vbeta = dataset.V * beta;
+    const int64_t n = dataset.offsets[j] + i;
+    const int old_t = t_n[n];
+    const int v = dataset.words[n];
+
+    /*
+     * Decrease counters
+     */
+    if (old_t >= 0) {
+        const int old_k = k_j_t[j][old_t];
+        s_sum -= beta * m_k[old_k] * inv_denom_k[old_k];
+        r_sum -= beta * n_k_of_j[old_k] * inv_denom_k[old_k];
+
+        --n_k[old_k];
+        n_k_v.add(v, old_k, -1);
+        --n_j_t[j][old_t];
+        n_j_t_v[j][old_t].add(v, -1);
+        --n_k_of_j[old_k];
+        inv_denom_k[old_k] = 1.0 / (n_k[old_k] + Vbeta);
+
+        if (n_j_t[j][old_t] == 0) {
+            remove_table(j, old_t, m_k, m);
+        }
+        s_sum += beta * m_k[old_k] * inv_denom_k[old_k];
+        r_sum += beta * n_k_of_j[old_k] * inv_denom_k[old_k];
+    }
+
+    /*
+     * Word buckets
+     */
+    double q_sum = 0.0;     // table-word
+    double w_sum = 0.0;     // dish-word
+    q_k.clear();
+    q_dishes.clear();
+    n_k_v.for_each(v, [&](const int k, const int n_kv) {
+        const double q = n_kv * inv_denom_k[k];
+        q_sum += n_k_of_j[k] * q;
+        w_sum += m_k[k] * q;
+        q_k.push_back(q);
+        q_dishes.push_back(k);
+    });
+    const double new_table_coef = alpha / (gamma + m);
+    const double new_table_sum = new_table_coef * (s_sum + w_sum + gamma / dataset.V);
+
+    /*
+     * Sampling
+     */
+    std::uniform_real_distribution<> dis(0.0, 1.0);
+    double u = dis(gen) * (q_sum + r_sum + new_table_sum);
+    int new_t = -1;
+    int new_k = -1;
+    if (u < q_sum) {
+        // a dish of the word, then one of its tables
+        for (unsigned int x = 0; x < q_dishes.size(); ++x) {
+            if (n_k_of_j[ q_dishes[x] ] > 0) {
+                new_k = q_dishes[x];
+                u -= n_k_of_j[new_k] * q_k[x];
+                if (u <= 0.0) {
+                    break;
+                }
+            }
+        }
+        std::uniform_int_distribution<> pick(0, n_k_of_j[new_k] - 1);
+        int c = pick(gen);
+        for (unsigned int t = 0; t < tables[j].size(); ++t) {
+            if (tables[j][t] == 1 && k_j_t[j][t] == new_k) {
+                new_t = t;
+                c -= n_j_t[j][t];
+                if (c < 0) {
+                    break;
+                }
+            }
+        }
+    } else if (u < q_sum + r_sum) {
+        // a table of the restaurant
+        u -= q_sum;
+        for (unsigned int t = 0; t < tables[j].size(); ++t) {
+            if (tables[j][t] == 1) {
+                new_t = t;
+                u -= beta * n_j_t[j][t] * inv_denom_k[ k_j_t[j][t] ];
+                if (u <= 0.0) {
+                    break;
+                }
+            }
+        }
+    }
+    // r_sum may be left slightly positive by rounding when the restaurant is empty
+    if (new_t < 0) {
+        // a new table
+        u = std::max(u - q_sum - r_sum, 0.0) / new_table_coef;
+        if (u < w_sum) {
+            for (unsigned int x = 0; x < q_dishes.size(); ++x) {
+                if (m_k[ q_dishes[x] ] > 0) {
+                    new_k = q_dishes[x];
+                    u -= m_k[new_k] * q_k[x];
+                    if (u <= 0.0) {
+                        break;
+                    }
+                }
+            }
+        } else if (u < w_sum + s_sum) {
+            u -= w_sum;
+            for (int k = 0; k < K; ++k) {
+                if (m_k[k] > 0) {
+                    new_k = k;
+                    u -= beta * m_k[k] * inv_denom_k[k];
+                    if (u <= 0.0) {
+                        break;
+                    }
+                }
+            }
+        }
+
+        // new_k == k^new
+        if (new_k < 0) {
+            new_k = assign_new_dish(n_k, n_k_v, m_k);
+        }
+
+        s_sum -= beta * m_k[new_k] * inv_denom_k[new_k];
+        new_t = add_new_table(j, new_k, m_k, m);
+        s_sum += beta * m_k[new_k] * inv_denom_k[new_k];
+    }
+
+    /*
+     * Update and Increase counters
+     */
+    new_k = k_j_t[j][new_t];
+    s_sum -= beta * m_k[new_k] * inv_denom_k[new_k];
+    r_sum -= beta * n_k_of_j[new_k] * inv_denom_k[new_k];
+
+    t_n[n] = new_t;
     ++n_j_t[j][new_t];
     ++n_k[new_k];
-    ++n_k_v[new_k][v];
-    ++n_j_t_v[j][new_t][v];
+    n_k_v.add(v, new_k, 1);
+    n_j_t_v[j][new_t].add(v, 1);
+    ++n_k_of_j[new_k];
+    inv_denom_k[new_k] = 1.0 / (n_k[new_k] + Vbeta);
+
+    s_sum += beta * m_k[new_k] * inv_denom_k[new_k];
+    r_sum += beta * n_k_of_j[new_k] * inv_denom_k[new_k];
 }
 
 /**
  * Remove an empty table
  *
+ * In a replica, a dish left with no tables is removed at the merge, since other threads may still serve it.
+ *
  * @param const int j the j-th doc(restaurant)
  * @param const int t the t-th table in the j-th doc(restaurant)
+ * @param std::vector<int64_t>& _m_k m_k to be used
+ * @param int64_t& _m m to be used
  */
-void HdpLda::remove_table(const int j, const int t) {
+void HdpLda::remove_table(const int j, const int t, std::vector<int64_t>& _m_k, int64_t& _m) {
     const int k = k_j_t[j][t];
 
     // Update and Decrease counters
     tables[j][t] = 0;
-    --m;
-    --m_k[k];
-    if (m_k[k] == 0) {
+    free_tables[j].push_back(t);
+    --_m;
+    --_m_k[k];
+    if (_m_k[k] == 0 && threads == 1) {
         remove_dish(k);
     }
 }
@@ -278,24 +894,35 @@ void HdpLda::remove_table(const int j, const int t) {
 /**
  * Assign a new dish(topic) to a table
  *
+ * In a replica, the dish is numbered by the shared counter and registered at the merge.
+ *
+ * @param std::vector<int64_t>& _n_k n_k to be used
+ * @param TopicWordCounts& _n_k_v n_kv to be used
+ * @param std::vector<int64_t>& _m_k m_k to be used
  * @return a new dish(topic)
  */
-int HdpLda::assign_new_dish() {
-    const int new_k = get_new_dish();
+int HdpLda::assign_new_dish(std::vector<int64_t>& _n_k, TopicWordCounts& _n_k_v, std::vector<int64_t>& _m_k) {
+    int new_k;
+    if (threads > 1) {
+        new_k = next_dish++;
+    } else {
+        new_k = get_new_dish();
+        if (new_k == K) {
+            dishes.resize(new_k + 1);
+            K = dishes.size();
+            inv_denom_k.resize(new_k + 1, 1.0 / (dataset.V * beta));
+            n_k_of_j.resize(new_k + 1, 0);
+        }
+        dishes[new_k] = 1;
+    }
 
     // new dish
-    if (new_k == K) {
-        dishes.resize(new_k + 1);
-        K = dishes.size();
-        m_k.resize(new_k + 1);
-        n_k.resize(new_k + 1);
-        n_k_v.resize(new_k + 1);
-        n_k_v[new_k].resize(dataset.V, 0);
+    if (new_k >= static_cast<int>(_n_k.size())) {
+        _m_k.resize(new_k + 1);
+        _n_k.resize(new_k + 1);
+        _n_k_v.resize(new_k + 1);
     }
 
-    // Update
-    dishes[new_k] = 1;
-
     return new_k;
 }
 
@@ -304,9 +931,11 @@ int HdpLda::assign_new_dish() {
  *
  * @param const int j the j-th doc(restaurant)
  * @param const int k a dish(topic) to be set on the table
+ * @param std::vector<int64_t>& _m_k m_k to be used
+ * @param int64_t& _m m to be used
  * @return a new table(new_t)
  */
-int HdpLda::add_new_table(const int j, const int k) {
+int HdpLda::add_new_table(const int j, const int k, std::vector<int64_t>& _m_k, int64_t& _m) {
     const unsigned int new_t = get_empty_table(j);
 
     // new table
@@ -315,14 +944,13 @@ int HdpLda::add_new_table(const int j, const int k) {
         k_j_t[j].resize(new_t + 1);
         n_j_t[j].resize(new_t + 1);
         n_j_t_v[j].resize(new_t + 1);
-        n_j_t_v[j][new_t].resize(dataset.V, 0);
     }
 
     // Update and Increase counters
     tables[j][new_t] = 1;
     k_j_t[j][new_t] = k;
-    ++m;
-    ++m_k[k];
+    ++_m;
+    ++_m_k[k];
 
     return new_t;
 }
@@ -330,29 +958,33 @@ int HdpLda::add_new_table(const int j, const int k) {
 /**
  * Get a dish that haven't been set yet or a new dish
  *
+ * A dish in the free list is taken off it, so the caller must set it on a table.
+ *
  * @return a new dish(topic)
  */
 int HdpLda::get_new_dish() {
-    for (int k = 0; k < K; ++k) {
-        if (dishes[k] == 0) {
-            return k;
-        }
+    if (free_dishes.empty()) {
+        return dishes.size();
     }
-    return dishes.size();
+    const int k = free_dishes.back();
+    free_dishes.pop_back();
+    return k;
 }
 
 /**
  * Get an empty table
  *
+ * A table in the free list is taken off it, so the caller must use it.
+ *
  * @return an empty table
  */
 int HdpLda::get_empty_table(const int j) {
-    for (unsigned int t = 0; t < tables[j].size(); ++t) {
-        if (tables[j][t] == 0) {
-            return t;
-        }
+    if (free_tables[j].empty()) {
+        return tables[j].size();
     }
-    return tables[j].size();
+    const int t = free_tables[j].back();
+    free_tables[j].pop_back();
+    return t;
 }
 
 /**
@@ -360,94 +992,96 @@ int HdpLda::get_empty_table(const int j) {
  *
  * @param const int j the j-th doc(restaurant)
  * @param const int t the t-th table in the j-th doc(restaurant)
+ * @param std::vector<int64_t>& _n_k n_k to be used
+ * @param TopicWordCounts& _n_k_v n_kv to be used
+ * @param std::vector<int64_t>& _m_k m_k to be used
+ * @param int64_t& _m m to be used
+ * @param std::mt19937& _gen random number generator to be used
+ * @param DenseBuffer& _buffer buffers to be used
  */
-void HdpLda::sampling_k(const int j, const int t) {
+void HdpLda::sampling_k(const int j, const int t, std::vector<int64_t>& _n_k, TopicWordCounts& _n_k_v,
+        std::vector<int64_t>& _m_k, int64_t& _m, std::mt19937& _gen, DenseBuffer& _buffer) {
     const int old_k = k_j_t[j][t];
     const int n_jt = n_j_t[j][t];
+    const WordHistogram& n_jt_v = n_j_t_v[j][t];
 
     /*
      * Decrease counters
      */
-    n_k[old_k] -= n_jt;
-    for (int v = 0; v < dataset.V; ++v) {
-        n_k_v[old_k][v] -= n_j_t_v[j][t][v];
+    _n_k[old_k] -= n_jt;
+    for (const auto& n_v : n_jt_v) {
+        _n_k_v.add(n_v.first, old_k, -n_v.second);
     }
-    --m_k[old_k];
-    if (m_k[old_k] == 0) {
+    --_m_k[old_k];
+    if (_m_k[old_k] == 0 && threads == 1) {
         remove_dish(old_k);
     }
 
     /*
      * Sampling
      */
+    const int _K = _n_k.size();
+    auto& f_k = _buffer.f_k;
     // f_k
+    // the rising factorials are lgamma differences
+    const double Vbeta = dataset.V * beta;
     double numer, denom;
-    std::priority_queue<double> queue_f_k;
-    std::vector<double> f_k(K+1);
-    for (int k = 0; k < K; ++k) {
-        if (m_k[k] == 0) {
+    double max_f_k = -HUGE_VAL;
+    f_k.resize(_K + 1);
+    for (int k = 0; k < _K; ++k) {
+        if (_m_k[k] == 0) {
             f_k[k] = 1;
             continue;
         }
-        numer = denom = 0.0;
-        for (int n = 0; n < n_j_t[j][t]; ++n) {
-            denom += std::log(dataset.V * beta + n_k[k] + n);
-        }
-        for (int v = 0; v < dataset.V; ++v) {
-            for (int n = 0; n < n_j_t_v[j][t][v]; ++n) {
-                numer += std::log(beta + n_k_v[k][v] + n);
-            }
+        denom = log_rising(lgamma_Vbeta, Vbeta, _n_k[k], n_jt);
+        numer = 0.0;
+        for (const auto& n_v : n_jt_v) {
+            numer += log_rising(lgamma_beta, beta, _n_k_v.get(n_v.first, k), n_v.second);
         }
         f_k[k] = numer - denom;
-        queue_f_k.push(f_k[k]);
+        max_f_k = std::max(max_f_k, f_k[k]);
     }
 
     // f_k^new
-    numer = denom = 0.0;
-    for (int n = 0; n < n_j_t[j][t]; ++n) {
-        denom += std::log(dataset.V * beta + n);
-    }
-    for (int v = 0; v < dataset.V; ++v) {
-        for (int n = 0; n < n_j_t_v[j][t][v]; ++n) {
-            numer += std::log(beta + n);
-        }
+    denom = log_rising(lgamma_Vbeta, Vbeta, 0, n_jt);
+    numer = 0.0;
+    for (const auto& n_v : n_jt_v) {
+        numer += log_rising(lgamma_beta, beta, 0, n_v.second);
     }
-    f_k[K] = numer - denom;
-    queue_f_k.push(f_k[K]);
+    f_k[_K] = numer - denom;
+    max_f_k = std::max(max_f_k, f_k[_K]);
 
     // normalizing
-    double max_f_k = queue_f_k.top();
-    for (int k = 0; k < K; ++k) {
-        if (m_k[k] != 0) {
+    for (int k = 0; k < _K; ++k) {
+        if (_m_k[k] != 0) {
             f_k[k] = std::exp(f_k[k] - max_f_k);
         }
     }
-    f_k[K] = std::exp(f_k[K] - max_f_k);
+    f_k[_K] = std::exp(f_k[_K] - max_f_k);
 
     // p_k
-    std::vector<double> p_k(K+1);
-    for (int k = 0; k < K; ++k) {
-        p_k[k] = m_k[k] * f_k[k];
+    double *p_k = _buffer.dis_k.weights(_K + 1);
+    for (int k = 0; k < _K; ++k) {
+        p_k[k] = _m_k[k] * f_k[k];
     }
-    p_k[K] = gamma * f_k[K];
+    p_k[_K] = gamma * f_k[_K];
 
     // sampling
-    std::discrete_distribution<> dis(begin(p_k), end(p_k));
-    int new_k = dis(gen);
+    int new_k = _buffer.dis_k(_K + 1, _gen);
 
     // new_k == k^new
-    if (new_k == K) {
-        new_k = assign_new_dish();
+    if (new_k == _K) {
+        new_k = assign_new_dish(_n_k, _n_k_v, _m_k);
     }
 
     /*
      * Update and Increase counters
      */
     k_j_t[j][t] = new_k;
-    ++m_k[new_k];
-    n_k[new_k] += n_jt;
-    for (int v = 0; v < dataset.V; ++v) {
-        n_k_v[new_k][v] += n_j_t_v[j][t][v];
+    ++_m_k[new_k];
+    _n_k[new_k] += n_jt;
+    for (const auto& n_v : n_jt_v) {
+        _n_k_v.add(n_v.first, new_k, n_v.second);
     }
 }
 
@@ -458,6 +1092,39 @@ void HdpLda::sampling_k(const int j, const int t) {
  */
 void HdpLda::remove_dish(const int k) {
     dishes[k] = 0;
+    free_dishes.push_back(k);
+}
+
+/**
+ * Renumber the using dishes from 0, and Shrink the counters of dishes to them
+ *
+ * Loops over dishes pay for removed dishes, so they are dropped after every sweep.
+ */
+void HdpLda::compact_dishes() {
+    std::vector<int> new_k(K, -1);
+    int new_K = 0;
+    for (int k = 0; k < K; ++k) {
+        if (dishes[k] == 1) {
+            new_k[k] = new_K;
+            m_k[new_K] = m_k[k];
+            n_k[new_K] = n_k[k];
+            ++new_K;
+        }
+    }
+    for (int j = 0; j < dataset.M; ++j) {
+        for (unsigned int t = 0; t < tables[j].size(); ++t) {
+            // an unused table is given a dish in range, since sampling_t reads f_k of every table
+            k_j_t[j][t] = (tables[j][t] == 1) ? new_k[ k_j_t[j][t] ] : 0;
+        }
+    }
+    n_k_v.relabel(new_k, new_K);
+
+    K = new_K;
+    dishes.assign(K, 1);
+    free_dishes.clear();
+    m_k.resize(K);
+    n_k.resize(K);
+    phi_k_v.resize(K);
 }
 
 /**
@@ -473,7 +1140,7 @@ double HdpLda::perplexity() {
             phi_k_v[k].clear();
             phi_k_v[k].reserve(dataset.V);
             for (int v = 0; v < dataset.V; ++v) {
-                phi_k_v[k].push_back( (beta + n_k_v[k][v]) / (dataset.V * beta + n_k[k]) );
+                phi_k_v[k].push_back( (beta + n_k_v.get(v, k)) / (dataset.V * beta + n_k[k]) );
             }
         }
     }
@@ -504,7 +1171,7 @@ double HdpLda::perplexity() {
     double log_per = 0.0;
     for (int j = 0; j < testset.M; ++j) {
         for (int i = 0; i < testset.n_m[j]; ++i) {
-            int v = testset.docs[j][i] - 1;
+            int v = testset.words[testset.offsets[j] + i];
             double sum = 0.0;
             for (int k = 0; k < K; ++k) {
                 if (dishes[k] == 1) {
@@ -532,37 +1199,64 @@ void HdpLda::learn(const unsigned int iteration, const unsigned int burn_in) {
     cout.precision(3);
     cout.setf(ios::fixed);
 
+    cout << "Load time: " << dataset.load_time + testset.load_time << "s" << endl;
+    cout << setprecision(1) << "n_kv = " << n_k_v.bytes() / 1048576.0 << " MB ("
+        << n_k_v.count_dense() << " of " << dataset.V << " words dense, "
+        << n_k_v.count_narrow() << " of them in 16 bits, "
+        << n_k_v.dense_bytes() / 1048576.0 << " MB if all dense)" << endl;
+    cout.precision(3);
+
+    cout << "threads = " << threads << endl;
+
     // Start time
     auto start = std::chrono::system_clock::now();
 
     /*
      * Inference
      */
-    std::cout << "iter\talpha\tgamma\ttopics\tperplexity\n";
-    // initialization
-    cout << 1 << "\t" << alpha << "\t" << gamma << "\t";
-    if (K == 0) {
-        inference(); // init according to CRF
+    double tokens_per_sec = 0.0;
+    std::cout << "iter\talpha\tgamma\ttopics\tperplexity\ttokens/sec\n";
+    if (first_iteration == 0) {
+        // initialization
+        cout << 1 << "\t" << alpha << "\t" << gamma << "\t";
+        auto sweep_start = std::chrono::system_clock::now();
+        if (K == 0) {
+            inference(); // init according to CRF
+        } else {
+            assign_random_topic();
+        }
+        auto sweep_end = std::chrono::system_clock::now();
+        tokens_per_sec = dataset.N / std::chrono::duration<double>(sweep_end - sweep_start).count();
+        cout << count_topics() << "\t" << perplexity() << "\t" << tokens_per_sec << endl;
+        if (burn_in < 1) {
+            // Update hyperparameters
+            update_gamma();
+            update_alpha();
+        }
+        if (checkpoint_interval == 1) {
+            checkpoint(1);
+        }
     } else {
-        assign_random_topic();
-    }
-    cout << count_topics() << "\t" << perplexity() << endl;
-    if (burn_in < 1) {
-        // Update hyperparameters
-        update_gamma();
-        update_alpha();
+        cout << "resumed at iteration " << first_iteration << endl;
     }
     // inference
-    for (unsigned int i = 2; i <= iteration; ++i) {
+    for (unsigned int i = std::max(first_iteration + 1, 2u); i <= iteration; ++i) {
         cout << i << "\t" << alpha << "\t" << gamma << "\t";
+        auto sweep_start = std::chrono::system_clock::now();
         inference();
-        cout << count_topics() << "\t" << perplexity() << endl;
+        auto sweep_end = std::chrono::system_clock::now();
+        tokens_per_sec = dataset.N / std::chrono::duration<double>(sweep_end - sweep_start).count();
+        cout << count_topics() << "\t" << perplexity() << "\t" << tokens_per_sec << endl;
         if (burn_in < i) {
             // Update hyperparameters
             update_gamma();
             update_alpha();
         }
+        if (checkpoint_interval > 0 && i % checkpoint_interval == 0) {
+            checkpoint(i);
+        }
     }
+    checkpoint_writer.wait();
 
     // End time
     auto end = std::chrono::system_clock::now();
@@ -606,30 +1300,56 @@ void HdpLda::dump() {
     // Print
     for (int k = 0; k < K; ++k) {
         if (dishes[k] == 1) {
-            printf("Topic: %d (%d words)\n", k, n_k[k]);
+            printf("Topic: %d (%lld words)\n", k, static_cast<long long>(n_k[k]));
             for (int i = 0; i < (n_k[k] > 10 ? 10 : n_k[k]); ++i) {
                 auto v = topic_word[k][i].first;
                 auto phi = topic_word[k][i].second;
-                printf("%s: %f (%d)\n", dataset.vocab[v].c_str(), phi, n_k_v[k][v]);
+                printf("%s: %f (%d)\n", dataset.vocab[v].c_str(), phi, n_k_v.get(v, k));
             }
             std::cout << std::endl;
         }
     }
 }
 
+/**
+ * Save the model
+ *
+ * Only the using dishes are saved, and they are renumbered from 0.
+ *
+ * @param const char *filename output file
+ */
+void HdpLda::save(const char *filename) {
+    std::vector<int> using_dishes;
+    for (int k = 0; k < K; ++k) {
+        if (dishes[k] == 1) {
+            using_dishes.push_back(k);
+        }
+    }
+    const int topics = using_dishes.size();
+
+    std::vector<double> alpha_z(topics);
+    std::vector<int64_t> n_z(topics);
+    std::vector<int> n_t_z(static_cast<size_t>(dataset.V) * topics);
+    for (int z = 0; z < topics; ++z) {
+        const int k = using_dishes[z];
+        alpha_z[z] = alpha * m_k[k] / (gamma + m);
+        n_z[z] = n_k[k];
+        for (int v = 0; v < dataset.V; ++v) {
+            n_t_z[static_cast<size_t>(v) * topics + z] = n_k_v.get(v, k);
+        }
+    }
+
+    Model::save(filename, Model::HDP_LDA, topics, dataset.V, alpha, beta, gamma,
+            alpha_z.data(), n_z.data(), n_t_z.data(), dataset.vocab);
+}
+
 /**
  * Get the number of topics
  *
  * @return the number of topics
  */
 int HdpLda::count_topics() {
-    int topics = 0;
-    for (auto k : dishes) {
-        if (k == 1) {
-            ++topics;
-        }
-    }
-    return topics;
+    return dishes.size() - free_dishes.size();
 }
 
 /**
@@ -639,13 +1359,7 @@ int HdpLda::count_topics() {
  * @return the number of topics
  */
 int HdpLda::count_tables(const int j) {
-    int table = 0;
-    for (auto t : tables[j]) {
-        if (t == 1) {
-            ++table;
-        }
-    }
-    return table;
+    return tables[j].size() - free_tables[j].size();
 }
 
 
@@ -16,16 +16,23 @@
 #define HDP_LDA_H
 
 #include <iostream>
+#include <iomanip>
 #include <vector>
-#include <queue>
 #include <utility>
 #include <string>
 #include <algorithm>
 #include <random>
 #include <chrono>
+#include <thread>
+#include <atomic>
 #include <cmath>
 #include "DataSet.hpp"
+#include "Model.hpp"
+#include "Checkpoint.hpp"
 #include "BetaDistribution.hpp"
+#include "CumulativeDistribution.hpp"
+#include "TopicWordCounts.hpp"
+#include "WordHistogram.hpp"
 
 class HdpLda {
     DataSet dataset;
@@ -40,21 +47,23 @@ class HdpLda {
     const double gamma_b; // scale parameter
 
     std::vector<std::vector<int>> tables; // using tables
+    std::vector<std::vector<int>> free_tables; // unused tables of each restaurant
     std::vector<int> dishes; // using dishes
+    std::vector<int> free_dishes; // unused dishes
     int K;  // size of dishes, not the number of topics. i.e. dishes.size()
 
-    std::vector<std::vector<int>> t_j_i;
+    std::vector<int> t_n;  // tables of dataset.words
 
     std::vector<std::vector<int>> n_j_t;
-    std::vector<std::vector<std::vector<int>>> n_j_t_v;
+    std::vector<std::vector<WordHistogram>> n_j_t_v;   // nonzero n_jtv of each table
 
-    std::vector<int> n_k;
-    std::vector<std::vector<int>> n_k_v;
+    std::vector<int64_t> n_k;
+    TopicWordCounts n_k_v;  // word-major, dense for frequent words
 
     std::vector<std::vector<int>> k_j_t;
 
-    int m;  // the number of tables that all the restaurants have
-    std::vector<int> m_k;
+    int64_t m;  // the number of tables that all the restaurants have
+    std::vector<int64_t> m_k;
 
     std::vector<std::vector<double>> phi_k_v;
     std::vector<std::vector<double>> theta_j_k;
@@ -62,28 +71,104 @@ class HdpLda {
     // random number generator
     std::mt19937 gen;
 
+public:
+    enum class Sampler { Dense, Sparse };
+
+private:
+    Sampler sampler;
+
+    /*
+     * Buckets of the sparse seating sampler
+     */
+    double s_sum;   // smoothing-only bucket, beta * sum_k m_k / (n_k + V * beta)
+    double r_sum;   // restaurant bucket, beta * sum_k n_jk / (n_k + V * beta)
+    std::vector<double> inv_denom_k;    // 1 / (n_k + V * beta)
+    std::vector<int> n_k_of_j;          // n_jk of the current restaurant, usually zero
+    std::vector<double> q_k;            // n_kv / (n_k + V * beta) of the current word
+    std::vector<int> q_dishes;          // dishes of q_k
+
+    // lgamma(beta + n) and lgamma(V * beta + n) for small n, used by sampling_k
+    std::vector<double> lgamma_beta;
+    std::vector<double> lgamma_Vbeta;
+
+    /*
+     * Buffers of the dense samplers, sampling_t and sampling_k, owned by each thread
+     */
+    struct DenseBuffer {
+        std::vector<double> f_k;
+        cumulative_distribution dis_t;
+        cumulative_distribution dis_k;
+    };
+    DenseBuffer dense_buffer;
+
+    /*
+     * Approximate parallel sampling
+     *   Each thread samples its own shard against a replica of n_k, n_kv, m_k and m,
+     *   and the differences of the replicas are merged at the end of each sweep.
+     *   New dishes are numbered by a shared counter, so those of different threads never collide.
+     */
+    struct Replica {
+        std::vector<int64_t> n_k;
+        TopicWordCounts n_k_v;
+        std::vector<int64_t> m_k;
+        int64_t m;
+        std::mt19937 gen;
+        DenseBuffer buffer;
+    };
+    unsigned int threads;
+    std::vector<Replica> replicas;
+    std::vector<int> shards;    // docs in [shards[i], shards[i+1]) are sampled by the i-th thread
+    std::atomic<int> next_dish; // the dish to be created next by a thread
+
+    /*
+     * Checkpoints
+     */
+    std::string checkpoint_file;
+    unsigned int checkpoint_interval;   // 0 if disabled
+    unsigned int first_iteration;       // the number of iterations done before resuming
+    CheckpointWriter checkpoint_writer;
+
     void init_vars();
     void assign_random_topic();
-    void sampling_t(const int j, const int i);
-    void sampling_k(const int j, const int t);
-    void remove_table(const int j, const int t);
+    void init_lgamma();
+    double log_rising(const std::vector<double>& lgamma_x, const double x, const int64_t n, const int c) const;
+    void sampling_t(const int j, const int i, std::vector<int64_t>& _n_k, TopicWordCounts& _n_k_v,
+            std::vector<int64_t>& _m_k, int64_t& _m, std::mt19937& _gen, DenseBuffer& _buffer);
+    void init_sparse();
+    void begin_doc_sparse(const int j);
+    void end_doc_sparse(const int j);
+    void sampling_t_sparse(const int j, const int i);
+    void sampling_k(const int j, const int t, std::vector<int64_t>& _n_k, TopicWordCounts& _n_k_v,
+            std::vector<int64_t>& _m_k, int64_t& _m, std::mt19937& _gen, DenseBuffer& _buffer);
+    void init_parallel();
+    void inference_parallel();
+    void remove_table(const int j, const int t, std::vector<int64_t>& _m_k, int64_t& _m);
     void remove_dish(const int k);
-    int assign_new_dish();
-    int add_new_table(const int j, const int k);
+    void init_free_lists();
+    void compact_dishes();
+    bool valid_state() const;
+    int assign_new_dish(std::vector<int64_t>& _n_k, TopicWordCounts& _n_k_v, std::vector<int64_t>& _m_k);
+    int add_new_table(const int j, const int k, std::vector<int64_t>& _m_k, int64_t& _m);
     int get_new_dish();
     int get_empty_table(const int j);
     void update_alpha();
     void update_gamma();
+    void checkpoint(const unsigned int iteration);
 
 public:
     HdpLda(const double _alpha, const double _alpha_a, const double _alpha_b, const double _beta,
             const double _gamma, const double _gamma_a, const double _gamma_b, const unsigned int K,
             const unsigned int _seed, const char *train, const char *test, const char *vocab);
     virtual ~HdpLda() = default;
+    void set_sampler(const Sampler _sampler);
+    void set_threads(const unsigned int _threads);
+    void set_checkpoint(const char *filename, const unsigned int interval);
+    void resume(const char *filename);
     void inference();
     double perplexity();
     void learn(const unsigned int iteration, const unsigned int burn_in);
     void dump();
+    void save(const char *filename);
     int count_topics();
     int count_tables(const int j);
 };
@@ -38,9 +38,15 @@ int main(int argc, char const* argv[])
         ("seed,s",      value<unsigned int>(),                      "seed value to use in the initialization of the internal state of std::mt19937. if not set, std::random_device is used for the initialization.")
         ("iteration,i", value<unsigned int>()->default_value(10),   "the number of times of inference")
         ("burn_in",     value<unsigned int>()->default_value(20),   "Burn-in period")
+        ("sampler",     value<string>()->default_value("dense"),    "seating algorithm [dense|sparse]")
+        ("threads",     value<unsigned int>()->default_value(1),    "the number of threads (dense sampler)")
         ("train",       value<string>(),                            "Training set")
         ("test",        value<string>(),                            "Test set")
-        ("vocab",       value<string>(),                            "Vocabulary");
+        ("vocab",       value<string>(),                            "Vocabulary")
+        ("save_model",  value<string>(),                            "save the trained model to a binary file")
+        ("checkpoint",  value<string>(),                            "write checkpoints to this file")
+        ("checkpoint_interval", value<unsigned int>()->default_value(10), "write a checkpoint every this number of iterations")
+        ("resume",      value<string>(),                            "resume from a checkpoint");
 
     // Parse the arguments and Store the result in vm.
     variables_map vm;
@@ -89,10 +95,39 @@ int main(int argc, char const* argv[])
         seed = rd();
     }
 
+    // sampler
+    HdpLda::Sampler sampler;
+    string sampler_name = vm["sampler"].as<string>();
+    if (sampler_name == "dense") {
+        sampler = HdpLda::Sampler::Dense;
+    } else if (sampler_name == "sparse") {
+        sampler = HdpLda::Sampler::Sparse;
+    } else {
+        cerr << "Unknown sampler: " << sampler_name << endl;
+        return 1;
+    }
+    // threads
+    const unsigned int threads = vm["threads"].as<unsigned int>();
+    if (threads > 1 && sampler != HdpLda::Sampler::Dense) {
+        cerr << "--threads is supported only by the dense sampler" << endl;
+        return 1;
+    }
+
     // HDP-LDA
     HdpLda hdplda(alpha, alpha_shape, alpha_scale, beta, gamma, gamma_shape,
             gamma_scale, K, seed, train.c_str(), test.c_str(), vocab.c_str());
+    hdplda.set_sampler(sampler);
+    hdplda.set_threads(threads);
+    if (vm.count("checkpoint")) {
+        hdplda.set_checkpoint(vm["checkpoint"].as<string>().c_str(), vm["checkpoint_interval"].as<unsigned int>());
+    }
+    if (vm.count("resume")) {
+        hdplda.resume(vm["resume"].as<string>().c_str());
+    }
     hdplda.learn(i, burn_in);
+    if (vm.count("save_model")) {
+        hdplda.save(vm["save_model"].as<string>().c_str());
+    }
 
     return 0;
 }
@@ -25,30 +25,32 @@
  * @param const char *test Test set
  * @param const char *vocab Vocabulary
  * @param bool _asymmetry If true, use Asymmetry Dirichlet distribution
+ * @param const char *assignments if not nullptr, z_n is kept in this file instead of memory
  */
 Lda::Lda(const unsigned int _K, const double _alpha, const double _beta, const unsigned int _seed,
-        const char *train, const char *test, const char *vocab, bool _asymmetry=false)
+        const char *train, const char *test, const char *vocab, bool _asymmetry,
+        const char *assignments)
     :dataset(train, vocab), testset(test), K(_K), alpha_z(_K, _alpha),
-    beta(_beta), asymmetry(_asymmetry), gen(_seed)
+    beta(_beta), asymmetry(_asymmetry), sampler(Sampler::Dense), s_sum(0.0), r_sum(0.0),
+    mh_steps(2), mh_rebuild(_K), smooth_sum(0.0), alpha_sum(0.0), threads(1),
+    parallel(Parallel::AdLda), out_of_core(assignments != nullptr), stream_begin(0), gen(_seed), checkpoint_interval(0), first_iteration(0)
 {
-    init();
+    init(assignments);
 }
 
 /**
  * Initialization
+ *
+ * @param const char *assignments if not nullptr, z_n is kept in this file instead of memory
  */
-void Lda::init() {
+void Lda::init(const char *assignments) {
     // n_mz
-    n_m_z.resize(dataset.M);
-    for (auto& n_z : n_m_z) {
-        n_z.resize(K, 0);
-    }
+    n_m_z.init(dataset.n_m, K);
+    dense_buffer.n_z_of_m.assign(K, 0);
+    dense_buffer.m = -1;
 
-    // n_zt
-    n_z_t.resize(K);
-    for (auto& n_t : n_z_t) {
-        n_t.resize(dataset.V, 0);
-    }
+    // n_tz
+    n_t_z.init(dataset.frequencies(), K);
 
     // n_z
     n_z.resize(K, 0);
@@ -56,29 +58,147 @@ void Lda::init() {
     /*
      * Topics
      */
-    z_m_n.resize(dataset.M);
+    if (out_of_core) {
+        if (!z_file.create(assignments, static_cast<size_t>(dataset.N) * sizeof(int))) {
+            std::cerr << "Can't create the file: " << assignments << std::endl;
+            exit(1);
+        }
+        z_n = reinterpret_cast<int *>(z_file.mutable_data());
+    } else {
+        z_buffer.resize(dataset.N);
+        z_n = z_buffer.data();
+    }
     std::uniform_int_distribution<> dis(0, K-1);
     for (int m = 0; m < dataset.M; ++m) {
-        z_m_n[m].resize(dataset.n_m[m]);
-        for (int n = 0; n < dataset.n_m[m]; ++n) {
+        stream_doc(m);
+        for (int64_t i = dataset.offsets[m]; i < dataset.offsets[m+1]; ++i) {
             auto z = dis(gen);
-            z_m_n[m][n] = z;
-            ++n_m_z[m][z];
-            ++n_z_t[z][dataset.docs[m][n] - 1];
+            z_n[i] = z;
+            ++dense_buffer.n_z_of_m[z];
+            n_t_z.add(dataset.words[i], z, 1);
             ++n_z[z];
         }
+        n_m_z.store(m, z_n + dataset.offsets[m], z_n + dataset.offsets[m+1], dense_buffer.n_z_of_m.data());
     }
+    stream_end();
+}
+
+/**
+ * Select a sampling algorithm
+ *
+ * Sampler::Dense evaluates all K topics for every word and is the reference implementation.
+ * Sampler::Sparse is SparseLDA, which draws from the same conditional distribution.
+ * Sampler::Alias is LightLDA, whose Metropolis-Hastings chain converges to it.
+ *
+ * @param const Sampler _sampler sampling algorithm
+ */
+void Lda::set_sampler(const Sampler _sampler) {
+    sampler = _sampler;
+}
+
+/**
+ * Set parameters of Metropolis-Hastings sampling
+ *
+ * At least one step is taken, since z_n never changes without proposals.
+ *
+ * @param const unsigned int _mh_steps the number of Metropolis-Hastings steps per word
+ * @param const unsigned int _mh_rebuild the number of draws from an alias table before it is rebuilt (if 0, K)
+ */
+void Lda::set_mh(const unsigned int _mh_steps, const unsigned int _mh_rebuild) {
+    mh_steps = std::max(_mh_steps, 1u);
+    mh_rebuild = (_mh_rebuild == 0) ? K : _mh_rebuild;
+}
+
+/**
+ * Set the number of threads
+ *
+ * If more than one thread is used, inference() runs AD-LDA or block-scheduled Gibbs sampling
+ * with the dense sampler.
+ *
+ * @param const unsigned int _threads the number of threads
+ * @param const Parallel _parallel parallel algorithm
+ */
+void Lda::set_threads(const unsigned int _threads, const Parallel _parallel) {
+    threads = (_threads == 0) ? 1 : _threads;
+    parallel = _parallel;
+}
+
+/**
+ * Write checkpoints periodically
+ *
+ * @param const char *filename checkpoint file
+ * @param const unsigned int interval write a checkpoint every interval iterations
+ */
+void Lda::set_checkpoint(const char *filename, const unsigned int interval) {
+    checkpoint_file = filename;
+    checkpoint_interval = interval;
+}
 
-    // phi
-    phi_z_t.resize(K);
-    for (auto& phi_t : phi_z_t) {
-        phi_t.resize(dataset.V);
+/**
+ * Write a checkpoint
+ *
+ * K, alpha_z, beta, z_n, n_z and the state of the random number generator are copied into a snapshot,
+ * which is written in the background. n_mz and n_tz are not saved since resume() recounts them from z_n.
+ * Note that the snapshot holds a copy of z_n even if it is out of core.
+ *
+ * @param const unsigned int iteration the number of iterations done
+ */
+void Lda::checkpoint(const unsigned int iteration) {
+    checkpoint_writer.begin(Model::LDA, iteration, dataset);
+    checkpoint_writer.put(K);
+    checkpoint_writer.put(alpha_z);
+    checkpoint_writer.put(beta);
+    checkpoint_writer.put(z_n, dataset.N);
+    checkpoint_writer.put(n_z);
+    checkpoint_writer.put(gen);
+    checkpoint_writer.commit(checkpoint_file);
+}
+
+/**
+ * Resume from a checkpoint
+ *
+ * With the dense sampler in one thread, the resumed chain is identical to the uninterrupted one.
+ * Otherwise the tables of the sampler and the generators of the threads are rebuilt,
+ * so the chain continues from the same state but with different draws.
+ *
+ * @param const char *filename checkpoint file
+ */
+void Lda::resume(const char *filename) {
+    CheckpointReader reader;
+    reader.open(filename, Model::LDA, dataset);
+
+    int _K;
+    reader.get(_K);
+    if (_K != K) {
+        std::cerr << "The number of topics of the checkpoint is " << _K << ": " << filename << std::endl;
+        exit(1);
+    }
+    reader.get(alpha_z);
+    reader.get(beta);
+    reader.get(z_n, dataset.N);
+    reader.get(n_z);
+    reader.get(gen);
+    first_iteration = reader.header.iteration;
+    if (alpha_z.size() != static_cast<size_t>(K) || n_z.size() != static_cast<size_t>(K)) {
+        std::cerr << "Invalid checkpoint: " << filename << std::endl;
+        exit(1);
+    }
+    for (int64_t i = 0; i < dataset.N; ++i) {
+        if (z_n[i] < 0 || z_n[i] >= K) {
+            std::cerr << "Invalid checkpoint: " << filename << std::endl;
+            exit(1);
+        }
     }
 
-    // theta
-    theta_m_z.resize(dataset.M);
-    for (auto& theta_z : theta_m_z) {
-        theta_z.resize(K);
+    // n_mz and n_zt
+    auto& n_z_of_m = dense_buffer.n_z_of_m;
+    n_t_z.init(dataset.frequencies(), K);
+    for (int m = 0; m < dataset.M; ++m) {
+        for (int64_t i = dataset.offsets[m]; i < dataset.offsets[m+1]; ++i) {
+            ++n_z_of_m[z_n[i]];
+            n_t_z.add(dataset.words[i], z_n[i], 1);
+        }
+        n_m_z.store(m, z_n + dataset.offsets[m], z_n + dataset.offsets[m+1], n_z_of_m.data());
     }
 }
 
@@ -89,11 +209,285 @@ void Lda::inference() {
     /*
      * Sampling z_mn
      */
+    if (threads > 1 && parallel == Parallel::Block) {
+        inference_block();
+    } else if (threads > 1) {
+        inference_parallel();
+    } else if (sampler == Sampler::Sparse) {
+        init_sparse();
+        for (int m = 0; m < dataset.M; ++m) {
+            stream_doc(m);
+            begin_doc_sparse(m);
+            for (int n = 0; n < dataset.n_m[m]; ++n) {
+                sampling_z_sparse(m, n);
+            }
+            end_doc_sparse();
+        }
+        stream_end();
+    } else if (sampler == Sampler::Alias) {
+        init_alias();
+        for (int m = 0; m < dataset.M; ++m) {
+            stream_doc(m);
+            for (int n = 0; n < dataset.n_m[m]; ++n) {
+                sampling_z_alias(m, n);
+            }
+        }
+        store_doc(dense_buffer);
+        stream_end();
+    } else {
+        reset_dense(n_z, dense_buffer);
+        for (int m = 0; m < dataset.M; ++m) {
+            stream_doc(m);
+            for (int n = 0; n < dataset.n_m[m]; ++n) {
+                sampling_z(m, n, n_t_z, n_z, gen, dense_buffer);
+            }
+        }
+        store_doc(dense_buffer);
+        stream_end();
+    }
+}
+
+/**
+ * Stream the words and the topics out of core
+ *
+ * Call this at the beginning of each doc of a sequential sweep.
+ * When a chunk has been sampled, it is dropped from memory, i.e. z_n is written back,
+ * and the chunk after the next one is read ahead while the next one is sampled.
+ *
+ * @param const int m the mth doc
+ */
+void Lda::stream_doc(const int m) {
+    if (!out_of_core) {
+        return;
+    }
+    const size_t i = dataset.offsets[m];
+    if (m == 0) {
+        stream_begin = 0;
+        dataset.prefetch(0, std::min<size_t>(2 * stream_chunk, dataset.N));
+        z_file.prefetch(0, 2 * stream_chunk * sizeof(int));
+    } else if (i >= stream_begin + stream_chunk) {
+        dataset.release(stream_begin, i);
+        z_file.release(stream_begin * sizeof(int), (i - stream_begin) * sizeof(int));
+        dataset.prefetch(i + stream_chunk, std::min<size_t>(i + 2 * stream_chunk, dataset.N));
+        z_file.prefetch((i + stream_chunk) * sizeof(int), stream_chunk * sizeof(int));
+        stream_begin = i;
+    }
+}
+
+/**
+ * Drop the last chunk at the end of a sequential sweep
+ */
+void Lda::stream_end() {
+    if (!out_of_core) {
+        return;
+    }
+    dataset.release(stream_begin, dataset.N);
+    z_file.release(stream_begin * sizeof(int), (dataset.N - stream_begin) * sizeof(int));
+}
+
+/**
+ * Initialize parallel Gibbs sampling
+ *
+ * Docs are divided into contiguous shards which have almost the same number of words.
+ * For block scheduling, the vocabulary is divided in the same way and the words of each doc shard
+ * are grouped by word block.
+ *
+ * @see David Newman, Arthur Asuncion, Padhraic Smyth, and Max Welling. Distributed algorithms for topic models. JMLR, 10:1801-1828, 2009.
+ * @see Hsiang-Fu Yu, et al. A scalable asynchronous distributed algorithm for topic modeling. WWW 2015.
+ */
+void Lda::init_parallel() {
+    // shards
+    shards.assign(1, 0);
+    long long words = 0;
     for (int m = 0; m < dataset.M; ++m) {
-        for (int n = 0; n < dataset.n_m[m]; ++n) {
-            sampling_z(m, n);
+        words += dataset.n_m[m];
+        if (words * threads >= static_cast<long long>(dataset.N) * static_cast<long long>(shards.size())
+                && shards.size() < threads) {
+            shards.push_back(m + 1);
         }
     }
+    while (shards.size() <= threads) {
+        shards.push_back(dataset.M);
+    }
+
+    // replicas
+    replicas.resize(threads);
+    for (auto& replica : replicas) {
+        replica.gen.seed(gen());
+    }
+
+    if (parallel != Parallel::Block) {
+        return;
+    }
+
+    // word blocks
+    const std::vector<int64_t> n_t = dataset.frequencies();
+    word_block.resize(dataset.V);
+    words = 0;
+    for (int t = 0; t < dataset.V; ++t) {
+        word_block[t] = std::min<long long>(words * threads / std::max<int64_t>(dataset.N, 1), threads - 1);
+        words += n_t[t];
+    }
+
+    // blocks
+    blocks.assign(threads * threads, std::vector<std::pair<int, int>>());
+    for (unsigned int i = 0; i < threads; ++i) {
+        for (int m = shards[i]; m < shards[i+1]; ++m) {
+            for (int n = 0; n < dataset.n_m[m]; ++n) {
+                const int b = word_block[ dataset.words[dataset.offsets[m] + n] ];
+                blocks[i * threads + b].push_back(std::make_pair(m, n));
+            }
+        }
+    }
+}
+
+/**
+ * Inference by AD-LDA
+ *
+ * Each thread samples its own shard against a replica of n_zt and n_z,
+ * and then the differences of the replicas are merged into the global counts.
+ */
+void Lda::inference_parallel() {
+    if (replicas.size() != threads) {
+        init_parallel();
+    }
+
+    // sampling
+    std::vector<std::thread> workers;
+    for (unsigned int i = 0; i < threads; ++i) {
+        workers.emplace_back([this, i]() {
+            auto& replica = replicas[i];
+            replica.n_t_z = n_t_z;
+            replica.n_z = n_z;
+            reset_dense(replica.n_z, replica.buffer);
+            for (int m = shards[i]; m < shards[i+1]; ++m) {
+                for (int n = 0; n < dataset.n_m[m]; ++n) {
+                    sampling_z(m, n, replica.n_t_z, replica.n_z, replica.gen, replica.buffer);
+                }
+            }
+            store_doc(replica.buffer);
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    workers.clear();
+
+    // reconciliation
+    for (unsigned int i = 0; i < threads; ++i) {
+        workers.emplace_back([this, i]() {
+            const long long V = dataset.V;
+            std::vector<int> n_z_of_t(K, 0);
+            for (int t = V * i / threads; t < V * (i + 1) / threads; ++t) {
+                n_t_z.load(t, n_z_of_t.data(), 1 - static_cast<int>(threads));
+                for (const auto& replica : replicas) {
+                    replica.n_t_z.load(t, n_z_of_t.data());
+                }
+                n_t_z.store(t, n_z_of_t.data());
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    merge_n_z();
+}
+
+/**
+ * Inference by block-scheduled Gibbs sampling
+ *
+ * In the s-th sub-epoch, the i-th thread samples the words of the i-th doc block
+ * which belong to the ((i + s) mod P)-th word block. Since no two threads share a doc or a word,
+ * n_mz and n_zt are updated exactly without locks. Only n_z, a vector of K counts,
+ * is replicated and merged after each sub-epoch.
+ */
+void Lda::inference_block() {
+    if (replicas.size() != threads || blocks.size() != threads * threads) {
+        init_parallel();
+    }
+
+    for (unsigned int s = 0; s < threads; ++s) {
+        std::vector<std::thread> workers;
+        for (unsigned int i = 0; i < threads; ++i) {
+            workers.emplace_back([this, i, s]() {
+                auto& replica = replicas[i];
+                replica.n_z = n_z;
+                reset_dense(replica.n_z, replica.buffer);
+                for (const auto& mn : blocks[i * threads + (i + s) % threads]) {
+                    sampling_z(mn.first, mn.second, n_t_z, replica.n_z, replica.gen, replica.buffer);
+                }
+                store_doc(replica.buffer);
+            });
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        merge_n_z();
+    }
+}
+
+/**
+ * Merge the differences of the replicas of n_z
+ */
+void Lda::merge_n_z() {
+    for (int z = 0; z < K; ++z) {
+        int64_t delta = 0;
+        for (const auto& replica : replicas) {
+            delta += replica.n_z[z] - n_z[z];
+        }
+        n_z[z] += delta;
+    }
+}
+
+/**
+ * Load n_mz of the mth doc into the dense counts of a buffer
+ *
+ * The doc loaded before is stored first.
+ *
+ * @param const int m the mth doc
+ * @param DenseBuffer& _buffer buffers to be used
+ */
+void Lda::load_doc(const int m, DenseBuffer& _buffer) {
+    store_doc(_buffer);
+    if (_buffer.n_z_of_m.empty()) {
+        _buffer.n_z_of_m.assign(K, 0);
+    }
+    n_m_z.load(m, _buffer.n_z_of_m.data());
+    _buffer.m = m;
+}
+
+/**
+ * Store the dense counts of a buffer into n_mz of its doc
+ *
+ * Call this before n_mz is read, e.g. at the end of each sweep.
+ *
+ * @param DenseBuffer& _buffer buffers to be used
+ */
+void Lda::store_doc(DenseBuffer& _buffer) {
+    const int m = _buffer.m;
+    if (m < 0) {
+        return;
+    }
+    n_m_z.store(m, z_n + dataset.offsets[m], z_n + dataset.offsets[m+1], _buffer.n_z_of_m.data());
+    _buffer.m = -1;
+}
+
+/**
+ * Recompute the reciprocals of the dense sampler
+ *
+ * Call this whenever n_z or alpha_z has been changed by others, e.g. at every sweep.
+ *
+ * @param const std::vector<int64_t>& _n_z topic counts to be used
+ * @param DenseBuffer& _buffer buffers to be reset
+ */
+void Lda::reset_dense(const std::vector<int64_t>& _n_z, DenseBuffer& _buffer) {
+    const double Vbeta = dataset.V * beta;
+    store_doc(_buffer);
+    _buffer.inv_denom_z.resize(K);
+    _buffer.coef_z.resize(K);
+    for (int z = 0; z < K; ++z) {
+        _buffer.inv_denom_z[z] = 1.0 / (_n_z[z] + Vbeta);
+    }
 }
 
 /**
@@ -101,74 +495,481 @@ void Lda::inference() {
  *
  * Perform Gibbs sampling once
  *
+ * 1 / (n_z + V * beta) and (alpha_z + n_mz) / (n_z + V * beta) are cached in _buffer
+ * and updated only for the old and the new topic, so p(z) takes one multiply-add per topic.
+ *
  * @param const int m the mth doc
  * @param const int n the nth word
+ * @param TopicWordCounts& _n_t_z word-topic counts to be used
+ * @param std::vector<int64_t>& _n_z topic counts to be used
+ * @param std::mt19937& _gen random number generator to be used
+ * @param DenseBuffer& _buffer buffers to be used
  */
-void Lda::sampling_z(const int m, const int n) {
+void Lda::sampling_z(const int m, const int n, TopicWordCounts& _n_t_z,
+        std::vector<int64_t>& _n_z, std::mt19937& _gen, DenseBuffer& _buffer) {
+    const double Vbeta = dataset.V * beta;
+    const int64_t i = dataset.offsets[m] + n;
     // word
-    const int t = dataset.docs[m][n];
+    const int t = dataset.words[i];
     // old topic
-    const int old_z = z_m_n[m][n];
+    const int old_z = z_n[i];
+
+    auto& inv_denom_z = _buffer.inv_denom_z;
+    auto& coef_z = _buffer.coef_z;
+    auto& n_z_of_m = _buffer.n_z_of_m;
+    if (_buffer.m != m) {
+        load_doc(m, _buffer);
+        for (int z = 0; z < K; ++z) {
+            coef_z[z] = (alpha_z[z] + n_z_of_m[z]) * inv_denom_z[z];
+        }
+    }
 
     /*
      * Delete old topic
      */
-    --n_m_z[m][old_z];
-    --n_z_t[old_z][t - 1];
-    --n_z[old_z];
+    --n_z_of_m[old_z];
+    _n_t_z.add(t, old_z, -1);
+    --_n_z[old_z];
+    inv_denom_z[old_z] = 1.0 / (_n_z[old_z] + Vbeta);
+    coef_z[old_z] = (alpha_z[old_z] + n_z_of_m[old_z]) * inv_denom_z[old_z];
 
     /*
      * Gibbs sampling
      */
-    std::vector<double> p_z(K);
-    for (int z = 0; z < K; ++z) {
-        p_z[z] = (alpha_z[z] + n_m_z[m][z]) * (beta + n_z_t[z][t - 1]) / (n_z[z] + dataset.V * beta);
+    double *p_z = _buffer.dis_z.weights(K);
+    const uint16_t *narrow_z_of_t = _n_t_z.narrow_row(t);
+    if (narrow_z_of_t != nullptr) {
+        topic_weights(K, coef_z.data(), beta, narrow_z_of_t, p_z);
+    } else {
+        if (_buffer.n_z_of_t.empty()) {
+            _buffer.n_z_of_t.assign(K, 0);
+        }
+        topic_weights(K, coef_z.data(), beta, _n_t_z.row(t, _buffer.n_z_of_t.data()), p_z);
     }
-    std::discrete_distribution<> dis(begin(p_z), end(p_z));
-    int new_z = dis(gen);
+    int new_z = _buffer.dis_z(K, _gen);
 
     /*
      * Update topic
      */
-    z_m_n[m][n] = new_z;
-    ++n_m_z[m][new_z];
-    ++n_z_t[new_z][t - 1];
-    ++n_z[new_z];
+    z_n[i] = new_z;
+    ++n_z_of_m[new_z];
+    _n_t_z.add(t, new_z, 1);
+    if (narrow_z_of_t == nullptr) {
+        _n_t_z.clear(t, _buffer.n_z_of_t.data());
+    }
+    ++_n_z[new_z];
+    inv_denom_z[new_z] = 1.0 / (_n_z[new_z] + Vbeta);
+    coef_z[new_z] = (alpha_z[new_z] + n_z_of_m[new_z]) * inv_denom_z[new_z];
 }
 
 /**
- * Compute Perplexity
+ * Initialize SparseLDA buckets
+ *
+ * The smoothing-only bucket and the coefficients are recomputed at every sweep
+ * because alpha_z may have been updated and to cancel rounding errors.
+ *
+ * @see Limin Yao, David Mimno, and Andrew McCallum. Efficient methods for topic model inference on streaming document collections. KDD 2009.
  */
-double Lda::perplexity() {
+void Lda::init_sparse() {
+    const double Vbeta = dataset.V * beta;
+
+    // topics which each dense word has, those of a sparse word are in n_t_z
+    if (word_topics.empty()) {
+        word_topics.resize(dataset.V);
+        for (int t = 0; t < dataset.V; ++t) {
+            if (n_t_z.is_dense(t)) {
+                auto& topics = word_topics[t];
+                n_t_z.for_each(t, [&](const int z, const int) { topics.push_back(z); });
+            }
+        }
+        doc_topic_pos.resize(K, -1);
+        doc_topics.reserve(K);
+        q_z.resize(K);
+        q_topics.reserve(K);
+    }
+
+    // smoothing-only bucket and coefficients
+    s_sum = 0.0;
+    coef_z.resize(K);
+    for (int z = 0; z < K; ++z) {
+        const double denom = n_z[z] + Vbeta;
+        s_sum += alpha_z[z] * beta / denom;
+        coef_z[z] = alpha_z[z] / denom;
+    }
+}
+
+/**
+ * Set up the document-topic bucket for the m-th doc
+ *
+ * @param const int m the mth doc
+ */
+void Lda::begin_doc_sparse(const int m) {
+    const double Vbeta = dataset.V * beta;
+
+    load_doc(m, dense_buffer);
+    for (auto it = n_m_z.begin(m); it != n_m_z.end(m); ++it) {
+        doc_topic_pos[it->first] = doc_topics.size();
+        doc_topics.push_back(it->first);
+    }
+
+    const auto& n_z_of_m = dense_buffer.n_z_of_m;
+    r_sum = 0.0;
+    for (auto z : doc_topics) {
+        const double denom = n_z[z] + Vbeta;
+        r_sum += n_z_of_m[z] * beta / denom;
+        coef_z[z] = (alpha_z[z] + n_z_of_m[z]) / denom;
+    }
+}
+
+/**
+ * Restore the coefficients changed by the current doc
+ */
+void Lda::end_doc_sparse() {
+    const double Vbeta = dataset.V * beta;
+
+    for (auto z : doc_topics) {
+        coef_z[z] = alpha_z[z] / (n_z[z] + Vbeta);
+        doc_topic_pos[z] = -1;
+    }
+    doc_topics.clear();
+    store_doc(dense_buffer);
+}
+
+/**
+ * Sampling z_mn by SparseLDA
+ *
+ * p(z) is divided into three buckets,
+ *   alpha_z * beta / (n_z + V * beta)            (smoothing-only)
+ *   n_mz * beta / (n_z + V * beta)               (document-topic)
+ *   (alpha_z + n_mz) * n_zt / (n_z + V * beta)   (topic-word)
+ * and only the nonzero terms of the last two are evaluated.
+ *
+ * @param const int m the mth doc
+ * @param const int n the nth word
+ */
+void Lda::sampling_z_sparse(const int m, const int n) {
+    const double Vbeta = dataset.V * beta;
+    const int64_t i = dataset.offsets[m] + n;
+    // word
+    const int t = dataset.words[i];
+    // old topic
+    const int old_z = z_n[i];
+    auto& n_z_of_m = dense_buffer.n_z_of_m;
+
     /*
-     * phi
+     * Delete old topic
      */
-    for (int z = 0; z < K; ++z) {
-        for (int t = 0; t < dataset.V; ++t) {
-            phi_z_t[z][t] = (beta + n_z_t[z][t]) / (n_z[z] + dataset.V * beta);
+    double denom = n_z[old_z] + Vbeta;
+    s_sum -= alpha_z[old_z] * beta / denom;
+    r_sum -= n_z_of_m[old_z] * beta / denom;
+
+    --n_z_of_m[old_z];
+    n_t_z.add(t, old_z, -1);
+    --n_z[old_z];
+
+    denom -= 1.0;
+    s_sum += alpha_z[old_z] * beta / denom;
+    r_sum += n_z_of_m[old_z] * beta / denom;
+    coef_z[old_z] = (alpha_z[old_z] + n_z_of_m[old_z]) / denom;
+
+    if (n_z_of_m[old_z] == 0) {
+        const int pos = doc_topic_pos[old_z];
+        doc_topics[pos] = doc_topics.back();
+        doc_topic_pos[doc_topics[pos]] = pos;
+        doc_topics.pop_back();
+        doc_topic_pos[old_z] = -1;
+    }
+    const bool dense = n_t_z.is_dense(t);
+    if (dense && n_t_z.get(t, old_z) == 0) {
+        auto& topics = word_topics[t];
+        *std::find(begin(topics), end(topics), old_z) = topics.back();
+        topics.pop_back();
+    }
+
+    /*
+     * Topic-word bucket
+     */
+    const auto& topics = dense ? word_topics[t] : q_topics;
+    double q_sum = 0.0;
+    if (dense) {
+        for (unsigned int j = 0; j < topics.size(); ++j) {
+            q_z[j] = coef_z[topics[j]] * n_t_z.get(t, topics[j]);
+            q_sum += q_z[j];
         }
+    } else {
+        q_topics.clear();
+        n_t_z.for_each(t, [&](const int z, const int n_tz) {
+            q_z[q_topics.size()] = coef_z[z] * n_tz;
+            q_sum += q_z[q_topics.size()];
+            q_topics.push_back(z);
+        });
     }
 
     /*
-     * theta
+     * Sampling
      */
-    for (int m = 0; m < dataset.M; ++m) {
-        for (int z = 0; z < K; ++z) {
-            theta_m_z[m][z] = (alpha_z[z] + n_m_z[m][z]) / (dataset.n_m[m] + K * alpha_z[z]);
+    std::uniform_real_distribution<> dis(0.0, 1.0);
+    double u = dis(gen) * (s_sum + r_sum + q_sum);
+    int new_z = -1;
+    if (u < q_sum) {
+        for (unsigned int j = 0; j < topics.size(); ++j) {
+            new_z = topics[j];
+            u -= q_z[j];
+            if (u <= 0.0) {
+                break;
+            }
+        }
+    } else {
+        u -= q_sum;
+        if (u < r_sum) {
+            for (auto z : doc_topics) {
+                new_z = z;
+                u -= n_z_of_m[z] * beta / (n_z[z] + Vbeta);
+                if (u <= 0.0) {
+                    break;
+                }
+            }
+        } else {
+            u -= r_sum;
+        }
+        if (new_z < 0) {
+            for (int z = 0; z < K; ++z) {
+                new_z = z;
+                u -= alpha_z[z] * beta / (n_z[z] + Vbeta);
+                if (u <= 0.0) {
+                    break;
+                }
+            }
         }
     }
 
+    /*
+     * Update topic
+     */
+    denom = n_z[new_z] + Vbeta;
+    s_sum -= alpha_z[new_z] * beta / denom;
+    r_sum -= n_z_of_m[new_z] * beta / denom;
+
+    z_n[i] = new_z;
+    ++n_z_of_m[new_z];
+    n_t_z.add(t, new_z, 1);
+    ++n_z[new_z];
+
+    denom += 1.0;
+    s_sum += alpha_z[new_z] * beta / denom;
+    r_sum += n_z_of_m[new_z] * beta / denom;
+    coef_z[new_z] = (alpha_z[new_z] + n_z_of_m[new_z]) / denom;
+
+    if (n_z_of_m[new_z] == 1) {
+        doc_topic_pos[new_z] = doc_topics.size();
+        doc_topics.push_back(new_z);
+    }
+    if (dense && n_t_z.get(t, new_z) == 1) {
+        word_topics[t].push_back(new_z);
+    }
+}
+
+/**
+ * Initialize alias tables shared by all the words
+ *
+ * The smoothing part of word-proposals, beta / (n_z + V * beta), and alpha_z of doc-proposals
+ * are rebuilt at every sweep. Per-word tables are rebuilt lazily in sampling_z_alias().
+ *
+ * @see Jinhui Yuan, et al. LightLDA: Big topic models on modest computer clusters. WWW 2015.
+ */
+void Lda::init_alias() {
+    const double Vbeta = dataset.V * beta;
+
+    if (word_proposal.empty()) {
+        word_proposal.resize(dataset.V);
+        for (auto& proposal : word_proposal) {
+            proposal.mass = 0.0;
+            proposal.draws = 0;
+        }
+    }
+
+    // smoothing
+    smooth_z.resize(K);
+    smooth_sum = 0.0;
+    for (int z = 0; z < K; ++z) {
+        smooth_z[z] = beta / (n_z[z] + Vbeta);
+        smooth_sum += smooth_z[z];
+    }
+    smooth_alias.build(begin(smooth_z), end(smooth_z));
+
+    // alpha
+    alpha_sum = 0.0;
+    for (auto alpha : alpha_z) {
+        alpha_sum += alpha;
+    }
+    alpha_alias.build(begin(alpha_z), end(alpha_z));
+}
+
+/**
+ * Build the word-proposal table of the t-th word
+ *
+ * @param const int t the t-th word
+ */
+void Lda::build_word_proposal(const int t) {
+    const double Vbeta = dataset.V * beta;
+    auto& proposal = word_proposal[t];
+
+    proposal.topics.clear();
+    proposal.values.clear();
+    proposal.mass = 0.0;
+    n_t_z.for_each(t, [&](const int z, const int n_tz) {
+        const double value = n_tz / (n_z[z] + Vbeta);
+        proposal.topics.push_back(z);
+        proposal.values.push_back(value);
+        proposal.mass += value;
+    });
+    if (!proposal.values.empty()) {
+        proposal.alias.build(begin(proposal.values), end(proposal.values));
+    }
+    proposal.draws = mh_rebuild;
+}
+
+/**
+ * Get the (unnormalized) probability that the word-proposal of the t-th word draws z
+ *
+ * @param const int t the t-th word
+ * @param const int z topic
+ * @return (n_zt + beta) / (n_z + V * beta) when the tables were built
+ */
+double Lda::word_proposal_density(const int t, const int z) {
+    const auto& proposal = word_proposal[t];
+    double density = smooth_z[z];
+    auto it = std::lower_bound(begin(proposal.topics), end(proposal.topics), z);
+    if (it != end(proposal.topics) && *it == z) {
+        density += proposal.values[it - begin(proposal.topics)];
+    }
+    return density;
+}
+
+/**
+ * Sampling z_mn by alias-table Metropolis-Hastings
+ *
+ * Word-proposals, (n_zt + beta) / (n_z + V * beta), and doc-proposals, n_mz + alpha_z,
+ * are drawn alternately in O(1) and accepted or rejected against the true conditional.
+ *
+ * @param const int m the mth doc
+ * @param const int n the nth word
+ */
+void Lda::sampling_z_alias(const int m, const int n) {
+    const double Vbeta = dataset.V * beta;
+    const int64_t i = dataset.offsets[m] + n;
+    // word
+    const int t = dataset.words[i];
+    // old topic
+    const int old_z = z_n[i];
+    if (dense_buffer.m != m) {
+        load_doc(m, dense_buffer);
+    }
+    auto& n_z_of_m = dense_buffer.n_z_of_m;
+
+    /*
+     * Delete old topic
+     */
+    --n_z_of_m[old_z];
+    n_t_z.add(t, old_z, -1);
+    --n_z[old_z];
+
+    /*
+     * Metropolis-Hastings
+     */
+    auto& proposal = word_proposal[t];
+    if (proposal.draws <= 0) {
+        build_word_proposal(t);
+    }
+
+    // target distribution
+    auto p = [&](const int z) -> double {
+        return (alpha_z[z] + n_z_of_m[z]) * (beta + n_t_z.get(t, z)) / (n_z[z] + Vbeta);
+    };
+    // doc-proposal, counting the current word as old_z
+    auto q_doc = [&](const int z) -> double {
+        return alpha_z[z] + n_z_of_m[z] + (z == old_z ? 1 : 0);
+    };
+
+    std::uniform_real_distribution<> dis(0.0, 1.0);
+    const int n_m = dataset.n_m[m];
+    int z = old_z;
+    double p_z = p(z);
+    for (int step = 0; step < mh_steps; ++step) {
+        int s;
+        double accept;
+        if (step % 2 == 0) {
+            // word-proposal
+            if (dis(gen) * (proposal.mass + smooth_sum) < proposal.mass) {
+                s = proposal.topics[ proposal.alias(gen) ];
+            } else {
+                s = smooth_alias(gen);
+            }
+            --proposal.draws;
+            const double p_s = p(s);
+            accept = p_s * word_proposal_density(t, z) / (p_z * word_proposal_density(t, s));
+            if (accept >= 1.0 || dis(gen) < accept) {
+                z = s;
+                p_z = p_s;
+            }
+        } else {
+            // doc-proposal
+            const double u = dis(gen) * (n_m + alpha_sum);
+            if (u < n_m) {
+                s = z_n[ dataset.offsets[m] + std::min(static_cast<int>(u), n_m - 1) ];
+            } else {
+                s = alpha_alias(gen);
+            }
+            const double p_s = p(s);
+            accept = p_s * q_doc(z) / (p_z * q_doc(s));
+            if (accept >= 1.0 || dis(gen) < accept) {
+                z = s;
+                p_z = p_s;
+            }
+        }
+    }
+    const int new_z = z;
+
+    /*
+     * Update topic
+     */
+    z_n[i] = new_z;
+    ++n_z_of_m[new_z];
+    n_t_z.add(t, new_z, 1);
+    ++n_z[new_z];
+}
+
+/**
+ * Compute Perplexity
+ */
+double Lda::perplexity() {
     /*
      * Perplexity
+     *   theta of each doc and phi of each word are computed on demand from the counts
      */
+    std::vector<double> theta_z(K);
+    std::vector<int> buffer(K, 0);
     double log_per = 0.0;
     for (int m = 0; m < testset.M; ++m) {
+        for (int z = 0; z < K; ++z) {
+            theta_z[z] = alpha_z[z] / (dataset.n_m[m] + K * alpha_z[z]);
+        }
+        for (auto it = n_m_z.begin(m); it != n_m_z.end(m); ++it) {
+            const int z = it->first;
+            theta_z[z] = (alpha_z[z] + it->second) / (dataset.n_m[m] + K * alpha_z[z]);
+        }
+        // divided by the denominator of phi, (beta + n_zt) / (n_z + V * beta)
+        for (int z = 0; z < K; ++z) {
+            theta_z[z] /= n_z[z] + dataset.V * beta;
+        }
         for (int n = 0; n < testset.n_m[m]; ++n) {
-            const int t = testset.docs[m][n] - 1;
+            const int t = testset.words[testset.offsets[m] + n];
+            const int *n_z_of_t = n_t_z.row(t, buffer.data());
             double sum = 0.0;
             for (int z = 0; z < K; ++z) {
-                sum += theta_m_z[m][z] * phi_z_t[z][t];
+                sum += theta_z[z] * (beta + n_z_of_t[z]);
             }
+            n_t_z.clear(t, buffer.data());
             log_per -= log(sum);
         }
     }
@@ -187,6 +988,8 @@ void Lda::learn(const unsigned int iteration, const unsigned int burn_in) {
     using namespace std;
     cout.setf(ios::fixed);
 
+    cout << "Load time: " << setprecision(3) << dataset.load_time + testset.load_time << "s" << endl;
+
     /*
      * Show Initial parameters
      */
@@ -197,15 +1000,28 @@ void Lda::learn(const unsigned int iteration, const unsigned int burn_in) {
         cout << setprecision(6) << "alpha = " << alpha_z[0] << endl;
     }
     cout << setprecision(6) << "beta = " << beta << endl;
+    cout << "threads = " << threads << endl;
+    cout << setprecision(1) << "n_zt = " << n_t_z.bytes() / 1048576.0 << " MB ("
+        << n_t_z.count_dense() << " of " << dataset.V << " words dense, "
+        << n_t_z.count_narrow() << " of them in 16 bits, "
+        << n_t_z.dense_bytes() / 1048576.0 << " MB if all dense)" << endl;
+    if (first_iteration > 0) {
+        cout << "resumed at iteration " << first_iteration << endl;
+    }
 
     // Start time
     auto start = std::chrono::system_clock::now();
 
     // Inference
     cout.precision(3);
-    cout << "iter\tperplexity\n";
-    for (unsigned int i = 0; i < iteration; ++i) {
-        cout << i << "\t" << perplexity() << endl;
+    cout << "iter\tperplexity\ttokens/sec\n";
+    double tokens_per_sec = 0.0;
+    for (unsigned int i = first_iteration; i < iteration; ++i) {
+        cout << i << "\t" << perplexity();
+        if (i > 0) {
+            cout << "\t" << tokens_per_sec;
+        }
+        cout << endl;
 
         /*
          * Update hyperparameters
@@ -216,9 +1032,17 @@ void Lda::learn(const unsigned int iteration, const unsigned int burn_in) {
             }
         }
 
+        auto sweep_start = std::chrono::system_clock::now();
         inference();
+        auto sweep_end = std::chrono::system_clock::now();
+        tokens_per_sec = dataset.N / std::chrono::duration<double>(sweep_end - sweep_start).count();
+
+        if (checkpoint_interval > 0 && (i + 1) % checkpoint_interval == 0) {
+            checkpoint(i + 1);
+        }
     }
-    cout << iteration << "\t" << perplexity() << endl;
+    checkpoint_writer.wait();
+    cout << iteration << "\t" << perplexity() << "\t" << tokens_per_sec << endl;
 
     // End time
     auto end = std::chrono::system_clock::now();
@@ -255,9 +1079,15 @@ void Lda::dump() {
     topic_word.resize(K);
     for (int z = 0; z < K; ++z) {
         topic_word[z].resize(dataset.V);
-        for (int t = 0; t < dataset.V; ++t) {
-            topic_word[z][t] = std::make_pair(t, phi_z_t[z][t]);
+    }
+    std::vector<int> buffer(K, 0);
+    for (int t = 0; t < dataset.V; ++t) {
+        const int *n_z_of_t = n_t_z.row(t, buffer.data());
+        for (int z = 0; z < K; ++z) {
+            const double phi = (beta + n_z_of_t[z]) / (n_z[z] + dataset.V * beta);
+            topic_word[z][t] = std::make_pair(t, phi);
         }
+        n_t_z.clear(t, buffer.data());
     }
 
     // Descending sort
@@ -269,16 +1099,30 @@ void Lda::dump() {
 
     // Print
     for (int z = 0; z < K; ++z) {
-        printf("Topic: %d (%d words)\n", z, n_z[z]);
+        printf("Topic: %d (%lld words)\n", z, static_cast<long long>(n_z[z]));
         for (int i = 0; i < (n_z[z] > 10 ? 10 : n_z[z]); ++i) {
             auto t = topic_word[z][i].first;
             auto phi = topic_word[z][i].second;
-            printf("%s: %f (%d)\n", dataset.vocab[t].c_str(), phi, n_z_t[z][t]);
+            printf("%s: %f (%d)\n", dataset.vocab[t].c_str(), phi, n_t_z.get(t, z));
         }
         std::cout << std::endl;
     }
 }
 
+/**
+ * Save the model
+ *
+ * @param const char *filename output file
+ */
+void Lda::save(const char *filename) {
+    std::vector<int> n_t_z_dense(static_cast<size_t>(dataset.V) * K, 0);
+    for (int t = 0; t < dataset.V; ++t) {
+        n_t_z.load(t, &n_t_z_dense[static_cast<size_t>(t) * K]);
+    }
+    Model::save(filename, Model::LDA, K, dataset.V, alpha_z[0], beta, 0.0,
+            alpha_z.data(), n_z.data(), n_t_z_dense.data(), dataset.vocab);
+}
+
 /**
  * Sampling new alpha
  */
@@ -290,13 +1134,17 @@ void Lda::update_alpha() {
         sum_alpha += alpha;
     }
 
-    double numer, denom;
-    for (int z = 0; z < K; ++z) {
-        numer = denom = 0.0;
-        for (int m = 0; m < dataset.M; ++m) {
-            numer += digamma(n_m_z[m][z] + alpha_z[z]) - digamma(alpha_z[z]);
-            denom += digamma(dataset.n_m[m] + sum_alpha) - digamma(sum_alpha);
+    // digamma(n_mz + alpha_z) - digamma(alpha_z) vanishes if n_mz = 0
+    std::vector<double> numer(K, 0.0);
+    double denom = 0.0;
+    for (int m = 0; m < dataset.M; ++m) {
+        for (auto it = n_m_z.begin(m); it != n_m_z.end(m); ++it) {
+            const int z = it->first;
+            numer[z] += digamma(it->second + alpha_z[z]) - digamma(alpha_z[z]);
         }
-        alpha_z[z] = alpha_z[z] * numer / denom;
+        denom += digamma(dataset.n_m[m] + sum_alpha) - digamma(sum_alpha);
+    }
+    for (int z = 0; z < K; ++z) {
+        alpha_z[z] = alpha_z[z] * numer[z] / denom;
     }
 }
@@ -22,9 +22,24 @@
 #include <algorithm>
 #include <random>
 #include <chrono>
+#include <thread>
 #include <cmath>
 #include <boost/math/special_functions/digamma.hpp>
 #include "DataSet.hpp"
+#include "Model.hpp"
+#include "Checkpoint.hpp"
+#include "AliasDistribution.hpp"
+#include "CumulativeDistribution.hpp"
+#include "TopicWeights.hpp"
+#include "SparseCounts.hpp"
+#include "TopicWordCounts.hpp"
+
+// precision of the reciprocals cached by the dense sampler
+#ifdef LDA_FLOAT_RECIPROCAL
+typedef float recip_t;
+#else
+typedef double recip_t;
+#endif
 
 /**
  * Latent Dirichlet Allocation
@@ -40,31 +55,141 @@ class Lda {
     std::vector<double> alpha_z;
     double beta;
 
-    std::vector<std::vector<int>> n_m_z;
-    std::vector<std::vector<int>> n_z_t;
-    std::vector<int> n_z;
-    std::vector<std::vector<int>> z_m_n;
-
-    std::vector<std::vector<double>> phi_z_t;
-    std::vector<std::vector<double>> theta_m_z;
+    SparseCounts n_m_z;         // nonzero n_mz of each doc
+    TopicWordCounts n_t_z;      // n_zt, dense for frequent words
+    std::vector<int64_t> n_z;   // may exceed 2^31 for a large corpus
+    int *z_n;                   // topics of dataset.words, in z_buffer or z_file
+    std::vector<int> z_buffer;
+    MappedFile z_file;
 
     bool asymmetry;
 
+public:
+    enum class Sampler { Dense, Sparse, Alias };
+    enum class Parallel { AdLda, Block };
+
+private:
+    Sampler sampler;
+
+    /*
+     * SparseLDA buckets
+     */
+    double s_sum;   // smoothing-only bucket
+    double r_sum;   // document-topic bucket
+    std::vector<double> coef_z;     // (alpha_z + n_mz) / (n_z + V * beta)
+    std::vector<double> q_z;        // topic-word bucket of the current word
+    std::vector<int> q_topics;      // topics of q_z
+    std::vector<int> doc_topics;    // topics s.t. n_mz > 0 in the current doc
+    std::vector<int> doc_topic_pos; // position in doc_topics, -1 if absent
+    std::vector<std::vector<int>> word_topics; // topics s.t. n_tz > 0 for each dense word
+
+    /*
+     * Alias-table Metropolis-Hastings (LightLDA)
+     */
+    struct WordProposal {
+        std::vector<int> topics;        // sorted topics s.t. n_tz > 0
+        std::vector<double> values;     // n_tz / (n_z + V * beta) when the table was built
+        alias_distribution alias;
+        double mass;
+        int draws;                      // the number of draws left before rebuilding
+    };
+    int mh_steps;
+    int mh_rebuild;
+    std::vector<WordProposal> word_proposal;
+    std::vector<double> smooth_z;       // beta / (n_z + V * beta) when smooth_alias was built
+    double smooth_sum;
+    alias_distribution smooth_alias;
+    double alpha_sum;
+    alias_distribution alpha_alias;
+
+    /*
+     * Buffers of the samplers, owned by each thread
+     */
+    struct DenseBuffer {
+        cumulative_distribution dis_z;
+        std::vector<recip_t> inv_denom_z;   // 1 / (n_z + V * beta)
+        std::vector<recip_t> coef_z;        // (alpha_z + n_mz) / (n_z + V * beta) of the doc m
+        std::vector<int> n_z_of_m;          // dense n_mz of the doc m
+        std::vector<int> n_z_of_t;          // dense copy of n_zt of a sparse word, usually zero
+        int m = -1;                         // the doc loaded into n_z_of_m, -1 if none
+    };
+
+    /*
+     * Parallel Gibbs sampling
+     *   AD-LDA: replicas of n_tz and n_z are merged at the end of each sweep
+     *   Block: a P x P grid of doc and word blocks is processed diagonal by diagonal
+     */
+    struct Replica {
+        TopicWordCounts n_t_z;
+        std::vector<int64_t> n_z;
+        std::mt19937 gen;
+        DenseBuffer buffer;
+    };
+    unsigned int threads;
+    Parallel parallel;
+    std::vector<Replica> replicas;
+    std::vector<int> shards;    // docs in [shards[i], shards[i+1]) are sampled by the i-th thread
+    std::vector<int> word_block;    // word block of each word
+    std::vector<std::vector<std::pair<int, int>>> blocks;  // (m, n) in [doc block * P + word block]
+
+    /*
+     * Out-of-core sampling
+     *   The words of a binary corpus and z_n in z_file are read ahead and dropped chunk by chunk.
+     */
+    bool out_of_core;
+    size_t stream_begin;    // the first word of the current chunk
+    static const size_t stream_chunk = 1 << 22;
+
     // random number generator
     std::mt19937 gen;
+    DenseBuffer dense_buffer;
+
+    /*
+     * Checkpoints
+     */
+    std::string checkpoint_file;
+    unsigned int checkpoint_interval;   // 0 if disabled
+    unsigned int first_iteration;       // the number of iterations done before resuming
+    CheckpointWriter checkpoint_writer;
 
-    void init();
-    void sampling_z(const int m, const int n);
+    void init(const char *assignments);
+    void stream_doc(const int m);
+    void stream_end();
+    void load_doc(const int m, DenseBuffer& _buffer);
+    void store_doc(DenseBuffer& _buffer);
+    void reset_dense(const std::vector<int64_t>& _n_z, DenseBuffer& _buffer);
+    void sampling_z(const int m, const int n, TopicWordCounts& _n_t_z,
+            std::vector<int64_t>& _n_z, std::mt19937& _gen, DenseBuffer& _buffer);
+    void init_parallel();
+    void inference_parallel();
+    void inference_block();
+    void merge_n_z();
+    void init_sparse();
+    void begin_doc_sparse(const int m);
+    void end_doc_sparse();
+    void sampling_z_sparse(const int m, const int n);
+    void init_alias();
+    void build_word_proposal(const int t);
+    double word_proposal_density(const int t, const int z);
+    void sampling_z_alias(const int m, const int n);
     void update_alpha();
+    void checkpoint(const unsigned int iteration);
 
 public:
     Lda(const unsigned int _K, const double _alpha, const double _beta, unsigned int _seed,
-            const char *train, const char *test, const char *vocab, bool asymmetry);
+            const char *train, const char *test, const char *vocab, bool asymmetry,
+            const char *assignments);
     virtual ~Lda() = default;
+    void set_sampler(const Sampler _sampler);
+    void set_mh(const unsigned int _mh_steps, const unsigned int _mh_rebuild);
+    void set_threads(const unsigned int _threads, const Parallel _parallel);
+    void set_checkpoint(const char *filename, const unsigned int interval);
+    void resume(const char *filename);
     void inference();
     double perplexity();
     void learn(const unsigned int iteration, const unsigned int burn_in);
     void dump();
+    void save(const char *filename);
 };
 
 #endif
@@ -0,0 +1,163 @@
+/*
+ * LdaClientMain.cpp
+ *
+ * Copyright (c) 2012 Tsukasa OMOTO <henry0312@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/* This file is available under an MIT license. */
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <cstring>
+#include <boost/program_options.hpp>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "DataSet.hpp"
+
+/**
+ * Connect to a Unix-domain socket
+ *
+ * @return file descriptor, or -1 on failure
+ */
+static int connect_socket(const std::string& path) {
+    sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+    const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd >= 0 && connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/**
+ * Send a request and receive its response line
+ *
+ * @return false if the connection is broken
+ */
+static bool request(const int fd, const std::string& line, std::string& response) {
+    size_t done = 0;
+    while (done < line.size()) {
+        const ssize_t n = write(fd, line.data() + done, line.size() - done);
+        if (n <= 0) {
+            return false;
+        }
+        done += n;
+    }
+    response.clear();
+    char c;
+    while (read(fd, &c, 1) == 1) {
+        if (c == '\n') {
+            return true;
+        }
+        response += c;
+    }
+    return false;
+}
+
+int main(int argc, char const* argv[])
+{
+    using namespace std;
+    using namespace boost::program_options;
+
+    // Set options
+    options_description opt("Options");
+    opt.add_options()
+        ("help,h",                                                  "show help")
+        ("socket",      value<string>(),                            "Unix-domain socket of ldaserver")
+        ("input",       value<string>(),                            "documents to be sent")
+        ("vocab",       value<string>(),                            "Vocabulary")
+        ("connections", value<unsigned int>()->default_value(1),    "the number of concurrent connections")
+        ("requests",    value<unsigned int>()->default_value(0),    "the number of requests. if 0, each document is sent once.");
+
+    // Parse the arguments and Store the result in vm.
+    variables_map vm;
+    store(parse_command_line(argc, argv, opt), vm);
+    notify(vm);
+
+    if ( vm.count("help") || !vm.count("socket") || !vm.count("input") || !vm.count("vocab") ) {
+        cout << opt << endl;
+        return 1;
+    }
+
+    const string path = vm["socket"].as<string>();
+    DataSet docs(vm["input"].as<string>().c_str(), vm["vocab"].as<string>().c_str());
+    const unsigned int connections = max(vm["connections"].as<unsigned int>(), 1u);
+    const int requests = vm["requests"].as<unsigned int>() > 0 ? vm["requests"].as<unsigned int>() : docs.M;
+
+    // requests
+    vector<string> lines(docs.M);
+    for (int m = 0; m < docs.M; ++m) {
+        for (int64_t i = docs.offsets[m]; i < docs.offsets[m+1]; ++i) {
+            lines[m] += docs.vocab[docs.words[i]];
+            lines[m] += ' ';
+        }
+        lines[m] += '\n';
+    }
+
+    // load
+    vector<double> latency(requests, 0.0);
+    vector<thread> workers;
+    atomic<bool> failed(false);
+    auto start = chrono::steady_clock::now();
+    for (unsigned int c = 0; c < connections; ++c) {
+        workers.emplace_back([&, c]() {
+            const int fd = connect_socket(path);
+            if (fd < 0) {
+                failed = true;
+                return;
+            }
+            string response;
+            for (int r = c; r < requests; r += connections) {
+                auto sent = chrono::steady_clock::now();
+                if (!request(fd, lines[r % docs.M], response)) {
+                    failed = true;
+                    break;
+                }
+                latency[r] = chrono::duration<double>(chrono::steady_clock::now() - sent).count();
+            }
+            close(fd);
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    const double elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    if (failed) {
+        cerr << "Can't talk to the server: " << path << endl;
+        return 1;
+    }
+
+    sort(begin(latency), end(latency));
+    cout.precision(6);
+    cout << "requests = " << requests << ", connections = " << connections << endl;
+    cout << "elapsed = " << elapsed << " sec, requests/sec = " << requests / elapsed << endl;
+    cout << "latency: p50 = " << latency[(requests - 1) / 2] * 1e3 << " ms, p99 = "
+        << latency[static_cast<size_t>(0.99 * (requests - 1))] * 1e3 << " ms" << endl;
+
+    // server-side counters
+    const int fd = connect_socket(path);
+    string response;
+    if (fd >= 0 && request(fd, "stats\n", response)) {
+        cout << "server: " << response << endl;
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+
+    return 0;
+}
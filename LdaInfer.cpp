@@ -0,0 +1,340 @@
+/*
+ * LdaInfer.cpp
+ *
+ * Copyright (c) 2012 Tsukasa OMOTO <henry0312@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/* This file is available under an MIT license. */
+
+#include "LdaInfer.hpp"
+
+/**
+ * Constructor
+ *
+ * @param const char *model_file model saved by Lda::save() or HdpLda::save()
+ * @param const unsigned int _seed seed value
+ */
+LdaInfer::LdaInfer(const char *model_file, const unsigned int _seed)
+    :sampler(Sampler::Dense), sweeps(20), burn_in(10), mh_steps(2), threads(1),
+    smooth_sum(0.0), seed(_seed)
+{
+    model.load(model_file);
+    K = model.K;
+    V = model.V;
+
+    const double Vbeta = V * model.beta;
+    inv_denom_z.resize(K);
+    for (int z = 0; z < K; ++z) {
+        inv_denom_z[z] = 1.0 / (model.n_z[z] + Vbeta);
+    }
+    alpha_sum = 0.0;
+    for (int z = 0; z < K; ++z) {
+        alpha_sum += model.alpha_z[z];
+    }
+    alpha_alias.build(model.alpha_z, model.alpha_z + K);
+
+    set_threads(1);
+}
+
+/**
+ * Set the sampling algorithm
+ *
+ * The alias tables are built with the current number of threads, so call set_threads() first.
+ *
+ * @param const Sampler _sampler sampling algorithm
+ */
+void LdaInfer::set_sampler(const Sampler _sampler) {
+    sampler = _sampler;
+    if (sampler == Sampler::Alias && word_alias.empty()) {
+        init_alias();
+    }
+}
+
+/**
+ * Set the number of Gibbs sweeps per document
+ *
+ * @param const unsigned int _sweeps the number of sweeps
+ * @param const unsigned int _burn_in sweeps not used to estimate theta
+ */
+void LdaInfer::set_sweeps(const unsigned int _sweeps, const unsigned int _burn_in) {
+    sweeps = std::max(_sweeps, 1u);
+    burn_in = std::min(_burn_in, static_cast<unsigned int>(sweeps - 1));
+}
+
+/**
+ * Set the number of Metropolis-Hastings steps per word (alias sampler)
+ *
+ * @param const unsigned int _mh_steps the number of steps
+ */
+void LdaInfer::set_mh(const unsigned int _mh_steps) {
+    mh_steps = std::max(_mh_steps, 1u);
+}
+
+/**
+ * Set the number of threads used for batches
+ *
+ * @param const unsigned int _threads the number of threads
+ */
+void LdaInfer::set_threads(const unsigned int _threads) {
+    threads = std::max(_threads, 1u);
+    buffers.resize(threads);
+    for (unsigned int i = 0; i < threads; ++i) {
+        buffers[i].gen.seed(seed + i);
+    }
+}
+
+/**
+ * Build the alias tables of word-proposals
+ *
+ * A word-proposal is phi_zt = n_tz / (n_z + V * beta) + beta / (n_z + V * beta),
+ * a sparse table over the topics s.t. n_tz > 0 and a shared smoothing table.
+ */
+void LdaInfer::init_alias() {
+    std::vector<double> smooth_z(K);
+    smooth_sum = 0.0;
+    for (int z = 0; z < K; ++z) {
+        smooth_z[z] = model.beta * inv_denom_z[z];
+        smooth_sum += smooth_z[z];
+    }
+    smooth_alias.build(begin(smooth_z), end(smooth_z));
+
+    word_topics.resize(V);
+    word_alias.resize(V);
+    word_mass.resize(V);
+    std::vector<std::thread> workers;
+    for (unsigned int i = 0; i < threads; ++i) {
+        workers.emplace_back([this, i]() {
+            std::vector<double> values;
+            for (int t = V * static_cast<long long>(i) / threads;
+                    t < V * static_cast<long long>(i + 1) / threads; ++t) {
+                const int *n_z_of_t = model.n_t_z + static_cast<size_t>(t) * K;
+                values.clear();
+                word_mass[t] = 0.0;
+                for (int z = 0; z < K; ++z) {
+                    if (n_z_of_t[z] > 0) {
+                        word_topics[t].push_back(z);
+                        values.push_back(n_z_of_t[z] * inv_denom_z[z]);
+                        word_mass[t] += values.back();
+                    }
+                }
+                if (!values.empty()) {
+                    word_alias[t].build(begin(values), end(values));
+                }
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+/**
+ * Sweep a document once by the dense sampler
+ *
+ * @param Buffer& buffer the document
+ */
+void LdaInfer::sweep_dense(Buffer& buffer) {
+    const double beta = model.beta;
+    const int n = buffer.t_n.size();
+    auto& n_z = buffer.n_z;
+    auto& coef_z = buffer.coef_z;
+
+    for (int i = 0; i < n; ++i) {
+        const int t = buffer.t_n[i];
+        const int old_z = buffer.z_n[i];
+
+        --n_z[old_z];
+        coef_z[old_z] = (model.alpha_z[old_z] + n_z[old_z]) * inv_denom_z[old_z];
+
+        double *p_z = buffer.dis_z.weights(K);
+        topic_weights(K, coef_z.data(), beta, model.n_t_z + static_cast<size_t>(t) * K, p_z);
+        const int new_z = buffer.dis_z(K, buffer.gen);
+
+        buffer.z_n[i] = new_z;
+        ++n_z[new_z];
+        coef_z[new_z] = (model.alpha_z[new_z] + n_z[new_z]) * inv_denom_z[new_z];
+    }
+}
+
+/**
+ * Sweep a document once by alias-table Metropolis-Hastings
+ *
+ * Since the word-proposal is exactly phi_zt, its acceptance rate only depends on the doc-topic counts.
+ *
+ * @param Buffer& buffer the document
+ */
+void LdaInfer::sweep_alias(Buffer& buffer) {
+    const double beta = model.beta;
+    const int n = buffer.t_n.size();
+    const double *alpha_z = model.alpha_z;
+    auto& n_z = buffer.n_z;
+    auto& gen = buffer.gen;
+    std::uniform_real_distribution<> dis(0.0, 1.0);
+
+    for (int i = 0; i < n; ++i) {
+        const int t = buffer.t_n[i];
+        const int old_z = buffer.z_n[i];
+        const int *n_z_of_t = model.n_t_z + static_cast<size_t>(t) * K;
+
+        --n_z[old_z];
+
+        // target distribution
+        auto p = [&](const int z) -> double {
+            return (alpha_z[z] + n_z[z]) * (beta + n_z_of_t[z]) * inv_denom_z[z];
+        };
+        // doc-proposal, counting the current word as old_z
+        auto q_doc = [&](const int z) -> double {
+            return alpha_z[z] + n_z[z] + (z == old_z ? 1 : 0);
+        };
+
+        int z = old_z;
+        for (int step = 0; step < mh_steps; ++step) {
+            int s;
+            double accept;
+            if (step % 2 == 0) {
+                // word-proposal
+                if (dis(gen) * (word_mass[t] + smooth_sum) < word_mass[t]) {
+                    s = word_topics[t][ word_alias[t](gen) ];
+                } else {
+                    s = smooth_alias(gen);
+                }
+                accept = (alpha_z[s] + n_z[s]) / (alpha_z[z] + n_z[z]);
+            } else {
+                // doc-proposal
+                const double u = dis(gen) * (n + alpha_sum);
+                if (u < n) {
+                    s = buffer.z_n[ std::min(static_cast<int>(u), n - 1) ];
+                } else {
+                    s = alpha_alias(gen);
+                }
+                accept = p(s) * q_doc(z) / (p(z) * q_doc(s));
+            }
+            if (accept >= 1.0 || dis(gen) < accept) {
+                z = s;
+            }
+        }
+
+        buffer.z_n[i] = z;
+        ++n_z[z];
+    }
+}
+
+/**
+ * Infer the topic distribution of a document
+ *
+ * Words out of the vocabulary of the model are ignored.
+ * theta_z is averaged over the sweeps after the burn-in.
+ *
+ * @param const int *words words of the doc (0-origin)
+ * @param const int n the number of words
+ * @param Buffer& buffer buffers to be used
+ * @param double *theta_z output, K values
+ */
+void LdaInfer::infer(const int *words, const int n, Buffer& buffer, double *theta_z) {
+    buffer.t_n.clear();
+    for (int i = 0; i < n; ++i) {
+        if (words[i] >= 0 && words[i] < V) {
+            buffer.t_n.push_back(words[i]);
+        }
+    }
+    const int n_d = buffer.t_n.size();
+
+    // random initialization
+    std::uniform_int_distribution<> dis(0, K - 1);
+    buffer.n_z.assign(K, 0);
+    buffer.z_n.resize(n_d);
+    for (int i = 0; i < n_d; ++i) {
+        buffer.z_n[i] = dis(buffer.gen);
+        ++buffer.n_z[buffer.z_n[i]];
+    }
+
+    std::fill(theta_z, theta_z + K, 0.0);
+    for (int s = 0; s < sweeps; ++s) {
+        if (n_d > 0) {
+            if (sampler == Sampler::Dense) {
+                buffer.coef_z.resize(K);
+                for (int z = 0; z < K; ++z) {
+                    buffer.coef_z[z] = (model.alpha_z[z] + buffer.n_z[z]) * inv_denom_z[z];
+                }
+                sweep_dense(buffer);
+            } else {
+                sweep_alias(buffer);
+            }
+        }
+        if (s >= burn_in) {
+            for (int z = 0; z < K; ++z) {
+                theta_z[z] += (model.alpha_z[z] + buffer.n_z[z]) / (n_d + alpha_sum);
+            }
+        }
+    }
+    for (int z = 0; z < K; ++z) {
+        theta_z[z] /= sweeps - burn_in;
+    }
+}
+
+/**
+ * Infer the topic distributions of documents in parallel
+ *
+ * Docs are handed out one by one, so long docs don't hold up a thread's whole share.
+ *
+ * @param const int *words words of the docs (0-origin)
+ * @param const int64_t *offsets words of the mth doc are in [offsets[m], offsets[m+1])
+ * @param const int M number of docs
+ * @param std::vector<double>& theta_m_z output, theta_m_z[m * K + z]
+ * @param std::vector<double>& latency output, seconds spent on each doc
+ */
+void LdaInfer::infer(const int *words, const int64_t *offsets, const int M,
+        std::vector<double>& theta_m_z, std::vector<double>& latency) {
+    theta_m_z.resize(static_cast<size_t>(M) * K);
+    latency.resize(M);
+
+    std::atomic<int> next(0);
+    auto work = [&](Buffer& buffer) {
+        for (int m = next++; m < M; m = next++) {
+            auto start = std::chrono::steady_clock::now();
+            infer(words + offsets[m], offsets[m+1] - offsets[m], buffer, &theta_m_z[static_cast<size_t>(m) * K]);
+            latency[m] = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        }
+    };
+    if (threads == 1) {
+        work(buffers[0]);
+        return;
+    }
+    std::vector<std::thread> workers;
+    for (unsigned int i = 0; i < threads; ++i) {
+        workers.emplace_back(work, std::ref(buffers[i]));
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+/**
+ * Compute the log-likelihood of a document
+ *
+ * @param const int *words words of the doc (0-origin)
+ * @param const int n the number of words
+ * @param const double *theta_z the topic distribution of the doc
+ * @return sum of log(sum_z theta_z * phi_zt) over the words in the vocabulary of the model
+ */
+double LdaInfer::log_likelihood(const int *words, const int n, const double *theta_z) const {
+    double log_likelihood = 0.0;
+    for (int i = 0; i < n; ++i) {
+        const int t = words[i];
+        if (t < 0 || t >= V) {
+            continue;
+        }
+        double sum = 0.0;
+        for (int z = 0; z < K; ++z) {
+            sum += theta_z[z] * model.phi(t, z);
+        }
+        log_likelihood += std::log(sum);
+    }
+    return log_likelihood;
+}
@@ -0,0 +1,100 @@
+/*
+ * LdaInfer.hpp
+ *
+ * Copyright (c) 2012 Tsukasa OMOTO <henry0312@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/* This file is available under an MIT license. */
+
+#ifndef LDA_INFER_H
+#define LDA_INFER_H
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <random>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <cmath>
+#include "Model.hpp"
+#include "AliasDistribution.hpp"
+#include "CumulativeDistribution.hpp"
+#include "TopicWeights.hpp"
+
+/**
+ * Topic inference of unseen documents against a frozen model
+ *
+ * Each document is folded in by its own Gibbs sweeps, which update only the local doc-topic counts.
+ * Since the topic-word distributions never change, the tables derived from them are built once at loading.
+ */
+class LdaInfer {
+    Model model;
+    int K;
+    int V;
+
+public:
+    enum class Sampler { Dense, Alias };
+
+    /*
+     * State of a document being inferred, owned by each thread
+     */
+    struct Buffer {
+        std::mt19937 gen;
+        std::vector<int> t_n;       // words of the doc in the vocabulary of the model
+        std::vector<int> z_n;       // topics of t_n
+        std::vector<int> n_z;       // doc-topic counts
+        std::vector<double> coef_z; // (alpha_z + n_z) / (n_z + V * beta) of the model
+        cumulative_distribution dis_z;
+    };
+
+private:
+    Sampler sampler;
+    int sweeps;
+    int burn_in;
+    int mh_steps;
+    unsigned int threads;
+
+    /*
+     * Frozen tables
+     */
+    double alpha_sum;
+    std::vector<double> inv_denom_z;    // 1 / (n_z + V * beta)
+    alias_distribution alpha_alias;     // alpha_z
+    alias_distribution smooth_alias;    // beta / (n_z + V * beta)
+    double smooth_sum;
+    std::vector<std::vector<int>> word_topics;  // topics s.t. n_tz > 0 for each word
+    std::vector<alias_distribution> word_alias; // n_tz / (n_z + V * beta) over word_topics
+    std::vector<double> word_mass;
+
+    std::vector<Buffer> buffers;
+    unsigned int seed;
+
+    void init_alias();
+    void sweep_dense(Buffer& buffer);
+    void sweep_alias(Buffer& buffer);
+
+public:
+    LdaInfer(const char *model_file, const unsigned int _seed);
+    virtual ~LdaInfer() = default;
+    void set_sampler(const Sampler _sampler);
+    void set_sweeps(const unsigned int _sweeps, const unsigned int _burn_in);
+    void set_mh(const unsigned int _mh_steps);
+    void set_threads(const unsigned int _threads);
+    int topics() const { return K; }
+    const std::vector<std::string>& vocab() const { return model.vocab; }
+    void infer(const int *words, const int n, Buffer& buffer, double *theta_z);
+    void infer(const int *words, const int64_t *offsets, const int M,
+            std::vector<double>& theta_m_z, std::vector<double>& latency);
+    double log_likelihood(const int *words, const int n, const double *theta_z) const;
+};
+
+#endif
@@ -0,0 +1,136 @@
+/*
+ * LdaInferMain.cpp
+ *
+ * Copyright (c) 2012 Tsukasa OMOTO <henry0312@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/* This file is available under an MIT license. */
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <random>
+#include <chrono>
+#include <boost/program_options.hpp>
+#include "LdaInfer.hpp"
+#include "DataSet.hpp"
+
+/**
+ * Get the q-quantile of values
+ */
+static double quantile(std::vector<double> values, const double q) {
+    if (values.empty()) {
+        return 0.0;
+    }
+    auto nth = begin(values) + static_cast<size_t>(q * (values.size() - 1));
+    std::nth_element(begin(values), nth, end(values));
+    return *nth;
+}
+
+int main(int argc, char const* argv[])
+{
+    using namespace std;
+    using namespace boost::program_options;
+
+    // Set options
+    options_description opt("Options");
+    opt.add_options()
+        ("help,h",                                                  "show help")
+        ("model",       value<string>(),                            "model saved by --save_model of lda or hdplda")
+        ("input",       value<string>(),                            "documents to be inferred")
+        ("output",      value<string>(),                            "write the topic distribution of each document, one per line")
+        ("seed,s",      value<unsigned int>(),                      "seed value to use in the initialization of the internal state of std::mt19937. if not set, std::random_device is used for the initialization.")
+        ("sweeps",      value<unsigned int>()->default_value(20),   "the number of Gibbs sweeps per document")
+        ("burn_in",     value<unsigned int>()->default_value(10),   "Burn-in period")
+        ("sampler",     value<string>()->default_value("dense"),    "sampling algorithm [dense|alias]")
+        ("mh_steps",    value<unsigned int>()->default_value(2),    "the number of Metropolis-Hastings steps per word (alias sampler)")
+        ("threads",     value<unsigned int>()->default_value(1),    "the number of threads");
+
+    // Parse the arguments and Store the result in vm.
+    variables_map vm;
+    store(parse_command_line(argc, argv, opt), vm);
+    notify(vm);
+
+    if ( vm.count("help") || !vm.count("model") || !vm.count("input") ) {
+        cout << opt << endl;
+        return 1;
+    }
+
+    // seed
+    unsigned int seed = 0;
+    if (vm.count("seed")) {
+        seed = vm["seed"].as<unsigned int>();
+    } else {
+        std::random_device rd;
+        seed = rd();
+    }
+    // sampler
+    LdaInfer::Sampler sampler;
+    string sampler_name = vm["sampler"].as<string>();
+    if (sampler_name == "dense") {
+        sampler = LdaInfer::Sampler::Dense;
+    } else if (sampler_name == "alias") {
+        sampler = LdaInfer::Sampler::Alias;
+    } else {
+        cerr << "Unknown sampler: " << sampler_name << endl;
+        return 1;
+    }
+
+    // model
+    auto start = chrono::steady_clock::now();
+    LdaInfer infer(vm["model"].as<string>().c_str(), seed);
+    infer.set_threads(vm["threads"].as<unsigned int>());
+    infer.set_sampler(sampler);
+    infer.set_sweeps(vm["sweeps"].as<unsigned int>(), vm["burn_in"].as<unsigned int>());
+    infer.set_mh(vm["mh_steps"].as<unsigned int>());
+    const int K = infer.topics();
+    cout << "K = " << K << endl;
+    cout << "V = " << infer.vocab().size() << endl;
+    cout << "model load time = " << chrono::duration<double>(chrono::steady_clock::now() - start).count() << " sec" << endl;
+
+    // documents
+    DataSet docs(vm["input"].as<string>().c_str());
+    cout << "input load time = " << docs.load_time << " sec" << endl;
+
+    // inference
+    vector<double> theta_m_z, latency;
+    start = chrono::steady_clock::now();
+    infer.infer(docs.words, docs.offsets, docs.M, theta_m_z, latency);
+    const double elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    double log_likelihood = 0.0;
+    for (int m = 0; m < docs.M; ++m) {
+        log_likelihood += infer.log_likelihood(docs.words + docs.offsets[m], docs.n_m[m], &theta_m_z[static_cast<size_t>(m) * K]);
+    }
+
+    cout.precision(6);
+    cout << "docs = " << docs.M << ", words = " << docs.N << endl;
+    cout << "elapsed = " << elapsed << " sec" << endl;
+    cout << "docs/sec = " << docs.M / elapsed << ", tokens/sec = " << docs.N / elapsed << endl;
+    cout << "latency: p50 = " << quantile(latency, 0.5) * 1e3 << " ms, p99 = "
+        << quantile(latency, 0.99) * 1e3 << " ms, max = " << quantile(latency, 1.0) * 1e3 << " ms" << endl;
+    cout << "perplexity = " << std::exp(-log_likelihood / docs.N) << endl;
+
+    // output
+    if (vm.count("output")) {
+        ofstream fout(vm["output"].as<string>());
+        if (!fout) {
+            cerr << "Can't open the file: " << vm["output"].as<string>() << endl;
+            return 1;
+        }
+        for (int m = 0; m < docs.M; ++m) {
+            for (int z = 0; z < K; ++z) {
+                fout << (z > 0 ? " " : "") << theta_m_z[static_cast<size_t>(m) * K + z];
+            }
+            fout << "\n";
+        }
+    }
+
+    return 0;
+}
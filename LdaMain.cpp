@@ -17,6 +17,7 @@
 #include <random>
 #include <boost/program_options.hpp>
 #include "Lda.hpp"
+#include "OnlineLda.hpp"
 
 int main(int argc, char const* argv[])
 {
@@ -36,7 +37,21 @@ int main(int argc, char const* argv[])
         ("train",       value<string>(),                            "Training set")
         ("test",        value<string>(),                            "Test set")
         ("vocab",       value<string>(),                            "Vocabulary")
-        ("asymmetry",                                               "Use Asymmetry Dirichlet distribution");
+        ("asymmetry",                                               "Use Asymmetry Dirichlet distribution")
+        ("sampler",     value<string>()->default_value("dense"),    "sampling algorithm [dense|sparse|alias]")
+        ("mh_steps",    value<unsigned int>()->default_value(2),    "the number of Metropolis-Hastings steps per word (alias sampler)")
+        ("mh_rebuild",  value<unsigned int>()->default_value(0),    "the number of draws from an alias table before it is rebuilt. if 0, the number of topics is used (alias sampler)")
+        ("threads",     value<unsigned int>()->default_value(1),    "the number of threads (dense sampler)")
+        ("parallel",    value<string>()->default_value("adlda"),    "parallel algorithm [adlda|block]")
+        ("save_model",  value<string>(),                            "save the trained model to a binary file")
+        ("checkpoint",  value<string>(),                            "write checkpoints to this file")
+        ("checkpoint_interval", value<unsigned int>()->default_value(10), "write a checkpoint every this number of iterations")
+        ("resume",      value<string>(),                            "resume from a checkpoint")
+        ("assignments", value<string>(),                            "keep the topics of words in this file instead of memory. with a binary training set, words are also streamed from the file (sequential sweeps only)")
+        ("online",                                                  "train by online variational Bayes, streaming the training set. --iteration is the number of passes.")
+        ("batch_size",  value<unsigned int>()->default_value(256),  "the number of docs in a mini-batch (online)")
+        ("tau0",        value<double>()->default_value(1024.0),     "learning rate (tau0 + t)^(-kappa) (online)")
+        ("kappa",       value<double>()->default_value(0.7),        "learning rate (tau0 + t)^(-kappa) (online)");
 
     // Parse the arguments and Store the result in vm.
     variables_map vm;
@@ -81,9 +96,66 @@ int main(int argc, char const* argv[])
         asymmetry = false;
     }
 
+    // sampler
+    Lda::Sampler sampler;
+    string sampler_name = vm["sampler"].as<string>();
+    if (sampler_name == "dense") {
+        sampler = Lda::Sampler::Dense;
+    } else if (sampler_name == "sparse") {
+        sampler = Lda::Sampler::Sparse;
+    } else if (sampler_name == "alias") {
+        sampler = Lda::Sampler::Alias;
+    } else {
+        cerr << "Unknown sampler: " << sampler_name << endl;
+        return 1;
+    }
+    // threads
+    const unsigned int threads = vm["threads"].as<unsigned int>();
+    if (threads > 1 && sampler != Lda::Sampler::Dense) {
+        cerr << "--threads is supported only by the dense sampler" << endl;
+        return 1;
+    }
+    // parallel
+    Lda::Parallel parallel;
+    string parallel_name = vm["parallel"].as<string>();
+    if (parallel_name == "adlda") {
+        parallel = Lda::Parallel::AdLda;
+    } else if (parallel_name == "block") {
+        parallel = Lda::Parallel::Block;
+    } else {
+        cerr << "Unknown parallel algorithm: " << parallel_name << endl;
+        return 1;
+    }
+
+    // online LDA
+    if (vm.count("online")) {
+        if (asymmetry || vm.count("checkpoint") || vm.count("resume") || vm.count("save_model")) {
+            cerr << "--asymmetry, --checkpoint, --resume and --save_model are not supported by --online" << endl;
+            return 1;
+        }
+        OnlineLda lda(K, alpha, beta, seed, train.c_str(), test.c_str(), vocab.c_str());
+        lda.set_batch_size(vm["batch_size"].as<unsigned int>());
+        lda.set_learning_rate(vm["tau0"].as<double>(), vm["kappa"].as<double>());
+        lda.learn(i);
+        return 0;
+    }
+
     // LDA
-    Lda lda(K, alpha, beta, seed, train.c_str(), test.c_str(), vocab.c_str(), asymmetry);
+    Lda lda(K, alpha, beta, seed, train.c_str(), test.c_str(), vocab.c_str(), asymmetry,
+            vm.count("assignments") ? vm["assignments"].as<string>().c_str() : nullptr);
+    lda.set_sampler(sampler);
+    lda.set_mh(vm["mh_steps"].as<unsigned int>(), vm["mh_rebuild"].as<unsigned int>());
+    lda.set_threads(threads, parallel);
+    if (vm.count("checkpoint")) {
+        lda.set_checkpoint(vm["checkpoint"].as<string>().c_str(), vm["checkpoint_interval"].as<unsigned int>());
+    }
+    if (vm.count("resume")) {
+        lda.resume(vm["resume"].as<string>().c_str());
+    }
     lda.learn(i, burn_in);
+    if (vm.count("save_model")) {
+        lda.save(vm["save_model"].as<string>().c_str());
+    }
 
     return 0;
 }
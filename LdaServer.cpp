@@ -0,0 +1,358 @@
+/*
+ * LdaServer.cpp
+ *
+ * Copyright (c) 2012 Tsukasa OMOTO <henry0312@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/* This file is available under an MIT license. */
+
+#include "LdaServer.hpp"
+#include <thread>
+#include <sstream>
+#include <cstdlib>
+#include <cerrno>
+#include <csignal>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+/**
+ * Write the whole buffer
+ *
+ * @return false if the client has gone away or hasn't read for the send timeout
+ */
+static bool write_all(const int fd, const std::string& data) {
+    size_t done = 0;
+    while (done < data.size()) {
+        const ssize_t n = write(fd, data.data() + done, data.size() - done);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        done += n;
+    }
+    return true;
+}
+
+/**
+ * Destructor
+ */
+LdaServer::Connection::~Connection() {
+    if (owned) {
+        close(in_fd);
+    }
+}
+
+/**
+ * Constructor
+ *
+ * @param LdaInfer& _infer inference engine with a loaded model
+ * @param const int _topk the number of topics in a response
+ * @param const int _max_batch the maximum number of requests in a batch
+ */
+LdaServer::LdaServer(LdaInfer& _infer, const int _topk, const int _max_batch)
+    :infer(_infer), topk(std::min(std::max(_topk, 1), _infer.topics())), max_batch(std::max(_max_batch, 1)),
+    stopping(false), start(clock::now()), requests(0), tokens(0), batches(0), latency(100000, 0.0)
+{
+    const auto& vocab = infer.vocab();
+    for (int t = 0; t < static_cast<int>(vocab.size()); ++t) {
+        word_id.emplace(vocab[t], t);
+    }
+    // a client closing its socket must not kill the server
+    std::signal(SIGPIPE, SIG_IGN);
+}
+
+/**
+ * Read requests from a client until it closes the connection
+ *
+ * A line longer than max_line is answered with an error as soon as it exceeds the limit,
+ * and the rest of it is dropped without being buffered.
+ *
+ * @param std::shared_ptr<Connection> connection the client
+ */
+void LdaServer::serve(std::shared_ptr<Connection> connection) {
+    std::string pending;
+    bool dropping = false;  // if the rest of a too long line is being dropped
+    char buffer[65536];
+    while (true) {
+        const ssize_t n = read(connection->in_fd, buffer, sizeof(buffer));
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+        pending.append(buffer, n);
+        size_t begin = 0, eol;
+        while ((eol = pending.find('\n', begin)) != std::string::npos) {
+            if (dropping) {
+                dropping = false;
+            } else if (eol - begin > max_line) {
+                push_error(connection, "request too long");
+            } else {
+                push(connection, pending.substr(begin, eol - begin));
+            }
+            begin = eol + 1;
+        }
+        pending.erase(0, begin);
+        if (pending.size() > max_line) {
+            if (!dropping) {
+                push_error(connection, "request too long");
+            }
+            dropping = true;
+            pending.clear();
+        }
+    }
+    if (!pending.empty() && !dropping) {
+        push(connection, pending);
+    }
+}
+
+/**
+ * Parse a request and queue it
+ *
+ * Unknown words are ignored.
+ * A malformed count, or more than max_tokens words, makes the request an error without allocating the words.
+ * Only a line which is "stats" itself asks for the counters; elsewhere "stats" is an ordinary word.
+ *
+ * @param const std::shared_ptr<Connection>& connection the client
+ * @param const std::string& line the request
+ */
+void LdaServer::push(const std::shared_ptr<Connection>& connection, const std::string& line) {
+    Request request;
+    request.connection = connection;
+    request.arrival = clock::now();
+    request.stats = false;
+
+    std::istringstream iss(line);
+    std::string token, rest;
+    if (iss >> token && token == "stats" && !(iss >> rest)) {
+        request.stats = true;
+        enqueue(request);
+        return;
+    }
+
+    iss.clear();
+    iss.seekg(0);
+    while (iss >> token) {
+        long count = 1;
+        const size_t colon = token.rfind(':');
+        if (colon != std::string::npos && colon > 0) {
+            const char *first = token.c_str() + colon + 1;
+            char *last;
+            errno = 0;
+            count = std::strtol(first, &last, 10);
+            if (last == first || *last != '\0' || errno == ERANGE || count < 0) {
+                request.error = "invalid count: " + token;
+                break;
+            }
+            token.resize(colon);
+        }
+        auto it = word_id.find(token);
+        if (it != word_id.end()) {
+            if (static_cast<unsigned long>(count) > max_tokens - request.words.size()) {
+                request.error = "too many words, the limit is " + std::to_string(max_tokens);
+                break;
+            }
+            request.words.insert(request.words.end(), count, it->second);
+        }
+    }
+    if (!request.error.empty()) {
+        request.words = std::vector<int>();
+    }
+    enqueue(request);
+}
+
+/**
+ * Queue an error for a client
+ *
+ * @param const std::shared_ptr<Connection>& connection the client
+ * @param const std::string& error the message
+ */
+void LdaServer::push_error(const std::shared_ptr<Connection>& connection, const std::string& error) {
+    Request request;
+    request.connection = connection;
+    request.arrival = clock::now();
+    request.stats = false;
+    request.error = error;
+    enqueue(request);
+}
+
+/**
+ * Queue a request for the batcher
+ *
+ * @param Request& request the request, which is moved
+ */
+void LdaServer::enqueue(Request& request) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        queue.push_back(std::move(request));
+    }
+    cond.notify_one();
+}
+
+/**
+ * Infer the queued requests batch by batch until the server stops
+ */
+void LdaServer::process() {
+    const int K = infer.topics();
+    std::vector<Request> batch;
+    std::vector<int> words;
+    std::vector<int64_t> offsets;
+    std::vector<double> theta_m_z, doc_latency;
+    std::vector<int> order(K);
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cond.wait(lock, [this]() { return stopping || !queue.empty(); });
+            if (queue.empty()) {
+                return;
+            }
+            const size_t n = std::min(queue.size(), static_cast<size_t>(max_batch));
+            std::move(queue.begin(), queue.begin() + n, std::back_inserter(batch));
+            queue.erase(queue.begin(), queue.begin() + n);
+        }
+
+        // inference
+        words.clear();
+        offsets.assign(1, 0);
+        for (const auto& request : batch) {
+            if (!request.stats && request.error.empty()) {
+                words.insert(words.end(), request.words.begin(), request.words.end());
+                offsets.push_back(words.size());
+            }
+        }
+        infer.infer(words.data(), offsets.data(), offsets.size() - 1, theta_m_z, doc_latency);
+        ++batches;
+
+        // responses
+        int m = 0;
+        for (const auto& request : batch) {
+            std::ostringstream oss;
+            if (request.stats) {
+                oss << stats();
+            } else if (!request.error.empty()) {
+                oss << "error: " << request.error;
+            } else {
+                const double *theta_z = &theta_m_z[static_cast<size_t>(m) * K];
+                for (int z = 0; z < K; ++z) {
+                    order[z] = z;
+                }
+                std::partial_sort(order.begin(), order.begin() + topk, order.end(),
+                        [theta_z](const int a, const int b) -> bool { return theta_z[a] > theta_z[b]; });
+                oss.precision(4);
+                for (int i = 0; i < topk; ++i) {
+                    oss << (i > 0 ? " " : "") << order[i] << ":" << theta_z[order[i]];
+                }
+                ++m;
+            }
+            oss << "\n";
+            // a client which has stalled is shut down, which also ends its reader
+            auto& connection = *request.connection;
+            if (!connection.dropped && !write_all(connection.out_fd, oss.str())) {
+                connection.dropped = true;
+                if (connection.owned) {
+                    shutdown(connection.out_fd, SHUT_RDWR);
+                }
+            }
+
+            if (!request.stats && request.error.empty()) {
+                latency[requests % latency.size()] = std::chrono::duration<double>(clock::now() - request.arrival).count();
+                ++requests;
+                tokens += request.words.size();
+            }
+        }
+        batch.clear();
+    }
+}
+
+/**
+ * Get the counters
+ *
+ * @return requests, tokens, batches, throughput and p50/p99 latency of the latest requests
+ */
+std::string LdaServer::stats() {
+    const double uptime = std::chrono::duration<double>(clock::now() - start).count();
+    std::vector<double> latest(latency.begin(), latency.begin() + std::min<long long>(requests, latency.size()));
+    auto quantile = [&latest](const double q) -> double {
+        if (latest.empty()) {
+            return 0.0;
+        }
+        auto nth = latest.begin() + static_cast<size_t>(q * (latest.size() - 1));
+        std::nth_element(latest.begin(), nth, latest.end());
+        return *nth;
+    };
+
+    std::ostringstream oss;
+    oss << "requests=" << requests << " tokens=" << tokens << " batches=" << batches
+        << " uptime=" << uptime << " requests/sec=" << requests / uptime << " tokens/sec=" << tokens / uptime
+        << " p50_ms=" << quantile(0.5) * 1e3 << " p99_ms=" << quantile(0.99) * 1e3;
+    return oss.str();
+}
+
+/**
+ * Serve the requests from stdin until EOF
+ *
+ * The responses are written to stdout and the counters to stderr at the end.
+ */
+void LdaServer::run_stdin() {
+    std::thread batcher(&LdaServer::process, this);
+    serve(std::make_shared<Connection>(STDIN_FILENO, STDOUT_FILENO, false));
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    cond.notify_one();
+    batcher.join();
+    std::cerr << stats() << std::endl;
+}
+
+/**
+ * Serve the requests over a Unix-domain socket
+ *
+ * Each client is read by its own thread, and all the clients share the batches.
+ *
+ * @param const char *path path of the socket, which is replaced if it exists
+ */
+void LdaServer::run_socket(const char *path) {
+    sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (std::strlen(path) >= sizeof(addr.sun_path)) {
+        std::cerr << "Too long socket path: " << path << std::endl;
+        exit(1);
+    }
+    std::strcpy(addr.sun_path, path);
+
+    const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(path);
+    if (fd < 0 || bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0 || listen(fd, 128) < 0) {
+        std::cerr << "Can't listen on the socket: " << path << std::endl;
+        exit(1);
+    }
+
+    std::thread batcher(&LdaServer::process, this);
+    while (true) {
+        const int client = accept(fd, nullptr, nullptr);
+        if (client < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            std::cerr << "Can't accept a connection: " << path << std::endl;
+            exit(1);
+        }
+        // a client which doesn't read its responses must not block the batcher
+        timeval timeout = {send_timeout, 0};
+        setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+        std::thread(&LdaServer::serve, this, std::make_shared<Connection>(client, client, true)).detach();
+    }
+}
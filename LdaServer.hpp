@@ -0,0 +1,101 @@
+/*
+ * LdaServer.hpp
+ *
+ * Copyright (c) 2012 Tsukasa OMOTO <henry0312@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/* This file is available under an MIT license. */
+
+#ifndef LDA_SERVER_H
+#define LDA_SERVER_H
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <unordered_map>
+#include <chrono>
+#include "LdaInfer.hpp"
+
+/**
+ * Topic inference server
+ *
+ * A request is a line of words, each of which may have a count, e.g. "apple:2 banana",
+ * and the response is a line of the top-k topics, e.g. "3:0.4512 17:0.2010".
+ * A line "stats" returns the counters instead.
+ * A socket client that doesn't read its responses for send_timeout seconds is dropped,
+ * so that it can't block the responses to the other clients.
+ * Requests that arrive while a batch is being inferred are inferred together as the next batch.
+ */
+class LdaServer {
+    typedef std::chrono::steady_clock clock;
+
+    /*
+     * A client, closed when the last request from it is answered
+     */
+    struct Connection {
+        int in_fd;
+        int out_fd;
+        bool owned;
+        std::atomic<bool> dropped;  // if a response couldn't be sent, the rest are discarded
+        Connection(const int _in_fd, const int _out_fd, const bool _owned)
+            :in_fd(_in_fd), out_fd(_out_fd), owned(_owned), dropped(false) {}
+        ~Connection();
+    };
+
+    struct Request {
+        std::shared_ptr<Connection> connection;
+        std::vector<int> words;
+        bool stats;
+        std::string error;          // if not empty, the request is answered with it instead of topics
+        clock::time_point arrival;
+    };
+
+    static const size_t max_tokens = 1 << 20;  // the maximum number of words in a request
+    static const size_t max_line = 64 * max_tokens; // the maximum length of a request in bytes
+    static const int send_timeout = 1;          // seconds to wait for a client to read a response
+
+    LdaInfer& infer;
+    const int topk;
+    const int max_batch;
+    std::unordered_map<std::string, int> word_id;
+
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::deque<Request> queue;
+    bool stopping;
+
+    /*
+     * Counters
+     */
+    clock::time_point start;
+    long long requests;
+    long long tokens;
+    long long batches;
+    std::vector<double> latency;    // ring buffer of the latest latencies (sec)
+
+    void serve(std::shared_ptr<Connection> connection);
+    void push(const std::shared_ptr<Connection>& connection, const std::string& line);
+    void push_error(const std::shared_ptr<Connection>& connection, const std::string& error);
+    void enqueue(Request& request);
+    void process();
+    std::string stats();
+
+public:
+    LdaServer(LdaInfer& _infer, const int _topk, const int _max_batch);
+    virtual ~LdaServer() = default;
+    void run_stdin();
+    void run_socket(const char *path);
+};
+
+#endif
@@ -0,0 +1,91 @@
+/*
+ * LdaServerMain.cpp
+ *
+ * Copyright (c) 2012 Tsukasa OMOTO <henry0312@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/* This file is available under an MIT license. */
+
+#include <iostream>
+#include <string>
+#include <random>
+#include <chrono>
+#include <boost/program_options.hpp>
+#include "LdaInfer.hpp"
+#include "LdaServer.hpp"
+
+int main(int argc, char const* argv[])
+{
+    using namespace std;
+    using namespace boost::program_options;
+
+    // Set options
+    options_description opt("Options");
+    opt.add_options()
+        ("help,h",                                                  "show help")
+        ("model",       value<string>(),                            "model saved by --save_model of lda or hdplda")
+        ("socket",      value<string>(),                            "listen on this Unix-domain socket. if not set, requests are read from stdin.")
+        ("topk",        value<unsigned int>()->default_value(10),   "the number of topics in a response")
+        ("max_batch",   value<unsigned int>()->default_value(256),  "the maximum number of requests inferred together")
+        ("seed,s",      value<unsigned int>(),                      "seed value to use in the initialization of the internal state of std::mt19937. if not set, std::random_device is used for the initialization.")
+        ("sweeps",      value<unsigned int>()->default_value(20),   "the number of Gibbs sweeps per document")
+        ("burn_in",     value<unsigned int>()->default_value(10),   "Burn-in period")
+        ("sampler",     value<string>()->default_value("dense"),    "sampling algorithm [dense|alias]")
+        ("mh_steps",    value<unsigned int>()->default_value(2),    "the number of Metropolis-Hastings steps per word (alias sampler)")
+        ("threads",     value<unsigned int>()->default_value(1),    "the number of threads inferring a batch");
+
+    // Parse the arguments and Store the result in vm.
+    variables_map vm;
+    store(parse_command_line(argc, argv, opt), vm);
+    notify(vm);
+
+    if ( vm.count("help") || !vm.count("model") ) {
+        cout << opt << endl;
+        return 1;
+    }
+
+    // seed
+    unsigned int seed = 0;
+    if (vm.count("seed")) {
+        seed = vm["seed"].as<unsigned int>();
+    } else {
+        std::random_device rd;
+        seed = rd();
+    }
+    // sampler
+    LdaInfer::Sampler sampler;
+    string sampler_name = vm["sampler"].as<string>();
+    if (sampler_name == "dense") {
+        sampler = LdaInfer::Sampler::Dense;
+    } else if (sampler_name == "alias") {
+        sampler = LdaInfer::Sampler::Alias;
+    } else {
+        cerr << "Unknown sampler: " << sampler_name << endl;
+        return 1;
+    }
+
+    // model (stdout is reserved for the responses)
+    auto start = chrono::steady_clock::now();
+    LdaInfer infer(vm["model"].as<string>().c_str(), seed);
+    infer.set_threads(vm["threads"].as<unsigned int>());
+    infer.set_sampler(sampler);
+    infer.set_sweeps(vm["sweeps"].as<unsigned int>(), vm["burn_in"].as<unsigned int>());
+    infer.set_mh(vm["mh_steps"].as<unsigned int>());
+    cerr << "K = " << infer.topics() << ", V = " << infer.vocab().size() << endl;
+    cerr << "model load time = " << chrono::duration<double>(chrono::steady_clock::now() - start).count() << " sec" << endl;
+
+    LdaServer server(infer, vm["topk"].as<unsigned int>(), vm["max_batch"].as<unsigned int>());
+    if (vm.count("socket")) {
+        server.run_socket(vm["socket"].as<string>().c_str());
+    } else {
+        server.run_stdin();
+    }
+
+    return 0;
+}
@@ -0,0 +1,217 @@
+/*
+ * MappedFile.hpp
+ *
+ * Copyright (c) 2012 Tsukasa OMOTO <henry0312@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/* This file is available under an MIT license. */
+
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+#include <fstream>
+#include <iterator>
+#include <algorithm>
+#if !defined(_WIN32) || defined(__CYGWIN__)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#define MAPPED_FILE_MMAP
+#endif
+
+/**
+ * Memory-mapped file
+ *
+ * A file is mapped read-only by open(), or read-write by create().
+ * Without mmap(2), the whole file is read into memory instead, and a created file is written on close().
+ */
+class MappedFile
+{
+    char *ptr;
+    size_t len;
+    bool writable;
+    std::string buffer;
+    std::string path;   // a created file
+public:
+    MappedFile() : ptr(nullptr), len(0), writable(false) {}
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile() { close(); }
+    bool open(const char *filename);
+    bool create(const char *filename, const size_t size);
+    void close();
+    const char *data() const { return ptr; }
+    char *mutable_data() { return writable ? ptr : nullptr; }
+    size_t size() const { return len; }
+    void prefetch(size_t offset, size_t size) const;
+    void release(size_t offset, size_t size) const;
+};
+
+/**
+ * Map a file
+ *
+ * @param const char *filename open *filename
+ * @return false if the file can't be opened
+ */
+inline bool MappedFile::open(const char *filename) {
+    close();
+#ifdef MAPPED_FILE_MMAP
+    const int fd = ::open(filename, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        ::close(fd);
+        return false;
+    }
+    len = st.st_size;
+    if (len > 0) {
+        void *p = mmap(nullptr, len, PROT_READ, MAP_SHARED, fd, 0);
+        if (p == MAP_FAILED) {
+            ::close(fd);
+            len = 0;
+            return false;
+        }
+        ptr = static_cast<char *>(p);
+    } else {
+        ptr = &buffer[0];
+    }
+    ::close(fd);
+    return true;
+#else
+    std::ifstream fin(filename, std::ios::binary);
+    if (!fin) {
+        return false;
+    }
+    buffer.assign(std::istreambuf_iterator<char>(fin), std::istreambuf_iterator<char>());
+    ptr = &buffer[0];
+    len = buffer.size();
+    return true;
+#endif
+}
+
+/**
+ * Create a zero-filled file and Map it read-write
+ *
+ * An existing file is truncated.
+ *
+ * @param const char *filename create *filename
+ * @param const size_t size the size of the file
+ * @return false if the file can't be created
+ */
+inline bool MappedFile::create(const char *filename, const size_t size) {
+    close();
+#ifdef MAPPED_FILE_MMAP
+    const int fd = ::open(filename, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    if (ftruncate(fd, size) != 0) {
+        ::close(fd);
+        return false;
+    }
+    len = size;
+    if (len > 0) {
+        void *p = mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (p == MAP_FAILED) {
+            ::close(fd);
+            len = 0;
+            return false;
+        }
+        ptr = static_cast<char *>(p);
+    } else {
+        ptr = &buffer[0];
+    }
+    ::close(fd);
+#else
+    std::ofstream fout(filename, std::ios::binary);
+    if (!fout) {
+        return false;
+    }
+    buffer.assign(size, '\0');
+    ptr = &buffer[0];
+    len = size;
+    path = filename;
+#endif
+    writable = true;
+    return true;
+}
+
+/**
+ * Ask the kernel to read a range ahead
+ *
+ * @param size_t offset the beginning of the range in bytes
+ * @param size_t size the size of the range in bytes
+ */
+inline void MappedFile::prefetch(size_t offset, size_t size) const {
+#ifdef MAPPED_FILE_MMAP
+    const size_t page = sysconf(_SC_PAGESIZE);
+    if (ptr == nullptr || offset >= len) {
+        return;
+    }
+    size = std::min(size, len - offset);
+    const size_t begin = offset / page * page;
+    madvise(ptr + begin, offset + size - begin, MADV_WILLNEED);
+#endif
+}
+
+/**
+ * Drop a range which won't be used for a while from memory
+ *
+ * Modified pages are scheduled to be written back.
+ * Only the pages entirely in the range are dropped.
+ *
+ * @param size_t offset the beginning of the range in bytes
+ * @param size_t size the size of the range in bytes
+ */
+inline void MappedFile::release(size_t offset, size_t size) const {
+#ifdef MAPPED_FILE_MMAP
+    const size_t page = sysconf(_SC_PAGESIZE);
+    if (ptr == nullptr || offset >= len) {
+        return;
+    }
+    size = std::min(size, len - offset);
+    const size_t begin = (offset + page - 1) / page * page;
+    const size_t end = (offset + size) / page * page;
+    if (begin >= end) {
+        return;
+    }
+    if (writable) {
+        msync(ptr + begin, end - begin, MS_ASYNC);
+    }
+    madvise(ptr + begin, end - begin, MADV_DONTNEED);
+#endif
+}
+
+/**
+ * Unmap the file
+ */
+inline void MappedFile::close() {
+#ifdef MAPPED_FILE_MMAP
+    if (ptr != nullptr && len > 0) {
+        munmap(ptr, len);
+    }
+#else
+    if (writable) {
+        std::ofstream fout(path, std::ios::binary);
+        fout.write(buffer.data(), buffer.size());
+    }
+#endif
+    buffer.clear();
+    path.clear();
+    ptr = nullptr;
+    len = 0;
+    writable = false;
+}
+
+#endif
@@ -0,0 +1,151 @@
+/*
+ * Model.cpp
+ *
+ * Copyright (c) 2012 Tsukasa OMOTO <henry0312@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/* This file is available under an MIT license. */
+
+#include "Model.hpp"
+
+/**
+ * Magic number of the binary model format
+ */
+static const char model_magic[8] = "LDAMODL";
+static const uint32_t model_version = 1;
+
+/**
+ * Constructor
+ */
+Model::Model()
+    :type(LDA), K(0), V(0), alpha(0.0), beta(0.0), gamma(0.0),
+    alpha_z(nullptr), n_z(nullptr), n_t_z(nullptr)
+{
+}
+
+/**
+ * Load a model
+ *
+ * The counts point to the mapped file, and only the vocabulary is copied.
+ *
+ * @param const char *filename open *filename
+ */
+void Model::load(const char *filename) {
+    if (!file.open(filename)) {
+        std::cerr << "Can't open the file: " << filename << std::endl;
+        exit(1);
+    }
+
+    ModelHeader header;
+    if (file.size() < sizeof(header) || std::memcmp(file.data(), model_magic, sizeof(model_magic)) != 0) {
+        std::cerr << "Not a model file: " << filename << std::endl;
+        exit(1);
+    }
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (header.version != model_version) {
+        std::cerr << "Unsupported version " << header.version << ": " << filename << std::endl;
+        exit(1);
+    }
+    if (header.K == 0 || header.K > INT_MAX || header.V > INT_MAX) {
+        std::cerr << "Invalid number of topics or words in the vocabulary: " << filename << std::endl;
+        exit(1);
+    }
+    // K and V are bounded, so each part is bounded by the rest of the file before the next one is added
+    size_t rest = file.size() - sizeof(header);
+    const size_t topics_size = header.K * (sizeof(double) + sizeof(int64_t));
+    if (rest < topics_size || header.V * header.K > (rest - topics_size) / sizeof(int32_t)) {
+        std::cerr << "Truncated file: " << filename << std::endl;
+        exit(1);
+    }
+    rest -= topics_size + header.V * header.K * sizeof(int32_t);
+    if (rest < header.vocab_size) {
+        std::cerr << "Truncated file: " << filename << std::endl;
+        exit(1);
+    }
+
+    type    = static_cast<Type>(header.type);
+    K       = header.K;
+    V       = header.V;
+    alpha   = header.alpha;
+    beta    = header.beta;
+    gamma   = header.gamma;
+
+    const char *p = file.data() + sizeof(header);
+    alpha_z = reinterpret_cast<const double *>(p);
+    p += K * sizeof(double);
+    n_z = reinterpret_cast<const int64_t *>(p);
+    p += K * sizeof(int64_t);
+    n_t_z = reinterpret_cast<const int *>(p);
+    p += static_cast<size_t>(V) * K * sizeof(int32_t);
+
+    // vocabulary
+    vocab.clear();
+    vocab.reserve(V);
+    const char *end = p + header.vocab_size;
+    while (p < end) {
+        const char *q = static_cast<const char *>(std::memchr(p, '\n', end - p));
+        if (q == nullptr) {
+            q = end;
+        }
+        vocab.emplace_back(p, q);
+        p = q + 1;
+    }
+}
+
+/**
+ * Save a model
+ *
+ * @param const char *filename output file
+ * @param const Type type LDA or HDP_LDA
+ * @param const int K the number of topics
+ * @param const int V the number of vocabulary
+ * @param const double alpha hyperparameter, alpha
+ * @param const double beta hyperparameter, beta
+ * @param const double gamma hyperparameter, gamma (HDP-LDA)
+ * @param const double *alpha_z prior of doc-topic distributions
+ * @param const int64_t *n_z the number of words assigned to each topic
+ * @param const int *n_t_z word-topic counts, word-major
+ * @param const std::vector<std::string>& vocab vocabulary
+ */
+void Model::save(const char *filename, const Type type, const int K, const int V,
+        const double alpha, const double beta, const double gamma, const double *alpha_z,
+        const int64_t *n_z, const int *n_t_z, const std::vector<std::string>& vocab) {
+    std::string words;
+    for (const auto& word : vocab) {
+        words += word;
+        words += '\n';
+    }
+
+    ModelHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, model_magic, sizeof(model_magic));
+    header.version      = model_version;
+    header.type         = type;
+    header.K            = K;
+    header.V            = V;
+    header.alpha        = alpha;
+    header.beta         = beta;
+    header.gamma        = gamma;
+    header.vocab_size   = words.size();
+
+    std::ofstream fout(filename, std::ios::binary);
+    if (!fout) {
+        std::cerr << "Can't open the file: " << filename << std::endl;
+        exit(1);
+    }
+    fout.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    fout.write(reinterpret_cast<const char *>(alpha_z), K * sizeof(double));
+    fout.write(reinterpret_cast<const char *>(n_z), K * sizeof(int64_t));
+    fout.write(reinterpret_cast<const char *>(n_t_z), static_cast<size_t>(V) * K * sizeof(int32_t));
+    fout.write(words.data(), words.size());
+    if (!fout) {
+        std::cerr << "Can't write the file: " << filename << std::endl;
+        exit(1);
+    }
+}
@@ -0,0 +1,86 @@
+/*
+ * Model.hpp
+ *
+ * Copyright (c) 2012 Tsukasa OMOTO <henry0312@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/* This file is available under an MIT license. */
+
+#ifndef MODEL_H
+#define MODEL_H
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <cstdint>
+#include <climits>
+#include "MappedFile.hpp"
+
+/**
+ * Header of the binary model format
+ *
+ * The header is followed by
+ *   double  alpha_z[K]     prior of doc-topic distributions
+ *   int64_t n_z[K]
+ *   int32_t n_t_z[V * K]   word-major
+ *   char    vocab[vocab_size]  words separated by '\n'
+ * in the native byte order.
+ */
+struct ModelHeader {
+    char magic[8];      // "LDAMODL"
+    uint32_t version;
+    uint32_t type;      // Model::Type
+    uint64_t K;
+    uint64_t V;
+    double alpha;
+    double beta;
+    double gamma;
+    uint64_t vocab_size;
+};
+
+/**
+ * Trained topic-word model of Lda or HdpLda
+ *
+ * A model file is memory-mapped read-only, so that processes which load the same model share its pages.
+ * For HdpLda, only the active topics are saved and alpha_z is alpha * m_k / (gamma + m).
+ */
+class Model {
+    MappedFile file;
+public:
+    enum Type { LDA = 0, HDP_LDA = 1 };
+
+    Type type;
+    int K;
+    int V;
+    double alpha;
+    double beta;
+    double gamma;
+    const double *alpha_z;
+    const int64_t *n_z;
+    const int *n_t_z;
+    std::vector<std::string> vocab;
+
+    Model();
+    virtual ~Model() = default;
+    void load(const char *filename);
+    static void save(const char *filename, const Type type, const int K, const int V,
+            const double alpha, const double beta, const double gamma, const double *alpha_z,
+            const int64_t *n_z, const int *n_t_z, const std::vector<std::string>& vocab);
+
+    /**
+     * Get phi_tz = (beta + n_tz) / (n_z + V * beta)
+     */
+    double phi(const int t, const int z) const {
+        return (beta + n_t_z[static_cast<size_t>(t) * K + z]) / (n_z[z] + V * beta);
+    }
+};
+
+#endif
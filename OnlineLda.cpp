@@ -0,0 +1,333 @@
+/*
+ * OnlineLda.cpp
+ *
+ * Copyright (c) 2012 Tsukasa OMOTO <henry0312@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/* This file is available under an MIT license. */
+
+#include "OnlineLda.hpp"
+
+/**
+ * Constructor
+ *
+ * @param const unsigned int _K the number of Topics
+ * @param const double _alpha hyperparameter, alpha
+ * @param const double _beta hyperparameter, beta
+ * @param const unsigned int _seed seed value
+ * @param const char *train Training set, which is streamed
+ * @param const char *test Test set
+ * @param const char *vocab Vocabulary
+ */
+OnlineLda::OnlineLda(const unsigned int _K, const double _alpha, const double _beta, const unsigned int _seed,
+        const char *train, const char *test, const char *vocab)
+    :stream(train, vocab), testset(test), K(_K), V(stream.V), alpha(_alpha), beta(_beta),
+    tau0(1024.0), kappa(0.7), batch_size(256), updates(0), gen(_seed)
+{
+    // lambda is initialized randomly as in the paper
+    std::gamma_distribution<> dis(100.0, 0.01);
+    lambda_t_z.resize(static_cast<size_t>(V) * K);
+    for (auto& lambda : lambda_t_z) {
+        lambda = dis(gen);
+    }
+    sstats_t_z.resize(static_cast<size_t>(V) * K, 0.0);
+    update_exp_elog_beta();
+}
+
+/**
+ * Set the learning rate, rho = (tau0 + updates)^(-kappa)
+ *
+ * @param const double _tau0 delay, which down-weights early batches
+ * @param const double _kappa forgetting rate in (0.5, 1]
+ */
+void OnlineLda::set_learning_rate(const double _tau0, const double _kappa) {
+    tau0 = _tau0;
+    kappa = _kappa;
+}
+
+/**
+ * Set the number of docs in a mini-batch
+ *
+ * @param const unsigned int _batch_size the number of docs
+ */
+void OnlineLda::set_batch_size(const unsigned int _batch_size) {
+    batch_size = std::max(_batch_size, 1u);
+}
+
+/**
+ * Compute exp(E[log beta_zt]) = exp(digamma(lambda_zt) - digamma(sum_t lambda_zt))
+ */
+void OnlineLda::update_exp_elog_beta() {
+    using boost::math::digamma;
+
+    std::vector<double> sum_z(K, 0.0);
+    for (int t = 0; t < V; ++t) {
+        for (int z = 0; z < K; ++z) {
+            sum_z[z] += lambda_t_z[static_cast<size_t>(t) * K + z];
+        }
+    }
+    for (auto& sum : sum_z) {
+        sum = digamma(sum);
+    }
+    exp_elog_beta_t_z.resize(lambda_t_z.size());
+    for (int t = 0; t < V; ++t) {
+        for (int z = 0; z < K; ++z) {
+            exp_elog_beta_t_z[static_cast<size_t>(t) * K + z] = std::exp(digamma(lambda_t_z[static_cast<size_t>(t) * K + z]) - sum_z[z]);
+        }
+    }
+}
+
+/**
+ * E-step
+ *
+ * Fit the variational doc-topic parameters, gamma, of each doc with lambda fixed.
+ *
+ * @param const std::vector<int>& words distinct words of the docs
+ * @param const std::vector<int>& counts counts of the words
+ * @param const std::vector<int>& offsets the dth doc is in [offsets[d], offsets[d+1])
+ * @param std::vector<double>& gamma_d_z output, gamma_d_z[d * K + z]
+ * @param const bool collect if true, accumulate the sufficient statistics in sstats_t_z
+ */
+void OnlineLda::e_step(const std::vector<int>& words, const std::vector<int>& counts,
+        const std::vector<int>& offsets, std::vector<double>& gamma_d_z, const bool collect) {
+    using boost::math::digamma;
+
+    const int docs = offsets.size() - 1;
+    gamma_d_z.resize(static_cast<size_t>(docs) * K);
+    std::gamma_distribution<> dis(100.0, 0.01);
+    std::vector<double> exp_elog_theta_z(K), new_gamma_z(K), phinorm;
+
+    for (int d = 0; d < docs; ++d) {
+        double *gamma_z = &gamma_d_z[static_cast<size_t>(d) * K];
+        const int first = offsets[d], last = offsets[d+1];
+        phinorm.resize(last - first);
+
+        auto update_theta = [&]() {
+            double sum = 0.0;
+            for (int z = 0; z < K; ++z) {
+                sum += gamma_z[z];
+            }
+            const double digamma_sum = digamma(sum);
+            for (int z = 0; z < K; ++z) {
+                exp_elog_theta_z[z] = std::exp(digamma(gamma_z[z]) - digamma_sum);
+            }
+        };
+        // phinorm_t = sum_z exp(E[log theta_z]) exp(E[log beta_zt]) of each word
+        auto update_phinorm = [&]() {
+            for (int i = first; i < last; ++i) {
+                const double *exp_elog_beta_z = &exp_elog_beta_t_z[static_cast<size_t>(words[i]) * K];
+                double sum = 1e-100;
+                for (int z = 0; z < K; ++z) {
+                    sum += exp_elog_theta_z[z] * exp_elog_beta_z[z];
+                }
+                phinorm[i - first] = sum;
+            }
+        };
+
+        for (int z = 0; z < K; ++z) {
+            gamma_z[z] = dis(gen);
+        }
+        update_theta();
+        update_phinorm();
+        for (int iter = 0; iter < 100; ++iter) {
+            std::fill(begin(new_gamma_z), end(new_gamma_z), 0.0);
+            for (int i = first; i < last; ++i) {
+                const double *exp_elog_beta_z = &exp_elog_beta_t_z[static_cast<size_t>(words[i]) * K];
+                const double c = counts[i] / phinorm[i - first];
+                for (int z = 0; z < K; ++z) {
+                    new_gamma_z[z] += c * exp_elog_beta_z[z];
+                }
+            }
+            double change = 0.0;
+            for (int z = 0; z < K; ++z) {
+                new_gamma_z[z] = alpha + exp_elog_theta_z[z] * new_gamma_z[z];
+                change += std::fabs(new_gamma_z[z] - gamma_z[z]);
+                gamma_z[z] = new_gamma_z[z];
+            }
+            update_theta();
+            update_phinorm();
+            if (change / K < 0.001) {
+                break;
+            }
+        }
+
+        if (collect) {
+            for (int i = first; i < last; ++i) {
+                const size_t t = words[i];
+                const double c = counts[i] / phinorm[i - first];
+                for (int z = 0; z < K; ++z) {
+                    sstats_t_z[t * K + z] += c * exp_elog_theta_z[z] * exp_elog_beta_t_z[t * K + z];
+                }
+            }
+        }
+    }
+}
+
+/**
+ * M-step
+ *
+ * lambda = (1 - rho) * lambda + rho * (beta + M / docs * sstats)
+ *
+ * @param const int docs the number of docs in the batch
+ */
+void OnlineLda::m_step(const int docs) {
+    const double rho = std::pow(tau0 + updates, -kappa);
+    const double scale = static_cast<double>(stream.M) / docs;
+    for (size_t tz = 0; tz < lambda_t_z.size(); ++tz) {
+        lambda_t_z[tz] = (1.0 - rho) * lambda_t_z[tz] + rho * (beta + scale * sstats_t_z[tz]);
+        sstats_t_z[tz] = 0.0;
+    }
+    update_exp_elog_beta();
+    ++updates;
+}
+
+/**
+ * Compute Perplexity
+ *
+ * theta of each test doc is inferred with lambda fixed.
+ */
+double OnlineLda::perplexity() {
+    std::vector<double> sum_z(K, 0.0);
+    for (int t = 0; t < V; ++t) {
+        for (int z = 0; z < K; ++z) {
+            sum_z[z] += lambda_t_z[static_cast<size_t>(t) * K + z];
+        }
+    }
+
+    std::vector<int> words, counts, offsets(1, 0);
+    std::vector<double> gamma_d_z;
+    double log_per = 0.0;
+    int64_t N = 0;
+    for (int m = 0; m < testset.M; ++m) {
+        words.clear();
+        counts.clear();
+        DocStream::count_words(testset.words + testset.offsets[m], testset.words + testset.offsets[m+1], words, counts);
+        while (!words.empty() && words.back() >= V) {
+            words.pop_back();
+            counts.pop_back();
+        }
+        offsets.assign({0, static_cast<int>(words.size())});
+        e_step(words, counts, offsets, gamma_d_z, false);
+
+        double sum_gamma = 0.0;
+        for (int z = 0; z < K; ++z) {
+            sum_gamma += gamma_d_z[z];
+        }
+        for (size_t i = 0; i < words.size(); ++i) {
+            double sum = 0.0;
+            for (int z = 0; z < K; ++z) {
+                sum += gamma_d_z[z] / sum_gamma * lambda_t_z[static_cast<size_t>(words[i]) * K + z] / sum_z[z];
+            }
+            log_per -= counts[i] * std::log(sum);
+            N += counts[i];
+        }
+    }
+    return std::exp(log_per / N);
+}
+
+/**
+ * Learning
+ *
+ * Stream the training set iteration times and Calculate perplexity after each pass
+ *
+ * @param const unsigned int iteration the number of passes
+ */
+void OnlineLda::learn(const unsigned int iteration) {
+    using namespace std;
+    cout.setf(ios::fixed);
+
+    cout << "Load time: " << setprecision(3) << testset.load_time << "s" << endl;
+
+    /*
+     * Show Initial parameters
+     */
+    cout << "K = " << K << endl;
+    cout << setprecision(6) << "alpha = " << alpha << endl;
+    cout << setprecision(6) << "beta = " << beta << endl;
+    cout << "batch_size = " << batch_size << ", tau0 = " << tau0 << ", kappa = " << kappa << endl;
+
+    // Start time
+    auto start = std::chrono::system_clock::now();
+
+    // Inference
+    cout.precision(3);
+    cout << "iter\tperplexity\ttokens/sec\n";
+    std::vector<int> words, counts, offsets;
+    std::vector<double> gamma_d_z;
+    double tokens_per_sec = 0.0;
+    for (unsigned int i = 0; i < iteration; ++i) {
+        cout << i << "\t" << perplexity();
+        if (i > 0) {
+            cout << "\t" << tokens_per_sec;
+        }
+        cout << endl;
+
+        auto pass_start = std::chrono::system_clock::now();
+        stream.rewind();
+        long long tokens = 0;
+        while (stream.next(batch_size, words, counts, offsets)) {
+            e_step(words, counts, offsets, gamma_d_z, true);
+            m_step(offsets.size() - 1);
+            for (auto c : counts) {
+                tokens += c;
+            }
+        }
+        auto pass_end = std::chrono::system_clock::now();
+        tokens_per_sec = tokens / std::chrono::duration<double>(pass_end - pass_start).count();
+    }
+    cout << iteration << "\t" << perplexity() << "\t" << tokens_per_sec << endl;
+
+    // End time
+    auto end = std::chrono::system_clock::now();
+
+    // Elapsed time
+    auto ms = std::chrono::duration_cast< std::chrono::milliseconds >(end - start).count();
+    int s = ms * 0.001; ms -= s * 1000;
+    int m = s / 60; s %= 60;
+    int h = m / 60; m %= 60;
+    cout << "Elapsed time: " << h << "h " << m << "m " << s << "." << ms << "s\n" << endl;
+
+    // topic-word distribution
+    dump();
+}
+
+/**
+ * Dump
+ *
+ * Print topic-word distribution, E[beta_zt] = lambda_zt / sum_t lambda_zt
+ */
+void OnlineLda::dump() {
+    std::vector<double> sum_z(K, 0.0);
+    for (int t = 0; t < V; ++t) {
+        for (int z = 0; z < K; ++z) {
+            sum_z[z] += lambda_t_z[static_cast<size_t>(t) * K + z];
+        }
+    }
+
+    std::vector<std::pair<int, double>> topic_word(V);
+    for (int z = 0; z < K; ++z) {
+        for (int t = 0; t < V; ++t) {
+            topic_word[t] = std::make_pair(t, lambda_t_z[static_cast<size_t>(t) * K + z] / sum_z[z]);
+        }
+        const int top = std::min(10, V);
+        std::partial_sort( begin(topic_word), begin(topic_word) + top, end(topic_word),
+                    [](const std::pair<int, double> &a, const std::pair<int, double> &b)
+                    -> bool { return a.second > b.second; } );
+
+        // sum_t (lambda_zt - beta) is the expected number of words in the corpus
+        printf("Topic: %d (%.0f words)\n", z, sum_z[z] - V * beta);
+        for (int i = 0; i < top; ++i) {
+            auto t = topic_word[i].first;
+            auto phi = topic_word[i].second;
+            printf("%s: %f (%.1f)\n", t < static_cast<int>(stream.vocab.size()) ? stream.vocab[t].c_str() : "?",
+                    phi, lambda_t_z[static_cast<size_t>(t) * K + z] - beta);
+        }
+        std::cout << std::endl;
+    }
+}
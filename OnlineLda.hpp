@@ -0,0 +1,74 @@
+/*
+ * OnlineLda.hpp
+ *
+ * Copyright (c) 2012 Tsukasa OMOTO <henry0312@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/* This file is available under an MIT license. */
+
+#ifndef ONLINE_LDA_H
+#define ONLINE_LDA_H
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <utility>
+#include <string>
+#include <algorithm>
+#include <random>
+#include <chrono>
+#include <cmath>
+#include <boost/math/special_functions/digamma.hpp>
+#include "DataSet.hpp"
+
+/**
+ * Latent Dirichlet Allocation by online variational Bayes
+ *
+ * The training set is streamed in mini-batches, and only K x V arrays of the topic-word parameters
+ * and the current batch are kept in memory.
+ *
+ * @see Matthew D. Hoffman, David M. Blei, and Francis Bach. Online learning for latent Dirichlet allocation. NIPS 2010.
+ */
+class OnlineLda {
+    DocStream stream;
+    DataSet testset;
+    const int K;
+    const int V;
+    double alpha;
+    double beta;    // eta in the paper
+
+    double tau0;    // learning rate, (tau0 + updates)^(-kappa)
+    double kappa;
+    int batch_size;
+    int updates;    // the number of mini-batches seen
+
+    std::vector<double> lambda_t_z;         // word-major, lambda_t_z[t * K + z]
+    std::vector<double> exp_elog_beta_t_z;  // exp(E[log beta_zt]), word-major
+    std::vector<double> sstats_t_z;         // sufficient statistics of a batch, word-major
+
+    // random number generator
+    std::mt19937 gen;
+
+    void update_exp_elog_beta();
+    void e_step(const std::vector<int>& words, const std::vector<int>& counts,
+            const std::vector<int>& offsets, std::vector<double>& gamma_d_z, const bool collect);
+    void m_step(const int docs);
+
+public:
+    OnlineLda(const unsigned int _K, const double _alpha, const double _beta, const unsigned int _seed,
+            const char *train, const char *test, const char *vocab);
+    virtual ~OnlineLda() = default;
+    void set_learning_rate(const double _tau0, const double _kappa);
+    void set_batch_size(const unsigned int _batch_size);
+    double perplexity();
+    void learn(const unsigned int iteration);
+    void dump();
+};
+
+#endif
@@ -0,0 +1,98 @@
+/*
+ * SparseCounts.hpp
+ *
+ * Copyright (c) 2012 Tsukasa OMOTO <henry0312@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/* This file is available under an MIT license. */
+
+#ifndef SPARSE_COUNTS_H
+#define SPARSE_COUNTS_H
+
+#include <vector>
+#include <utility>
+#include <algorithm>
+
+/**
+ * Sparse topic counts of documents
+ *
+ * The nonzero counts of the mth doc are kept as (topic, count) pairs sorted by topic
+ * in a slot of min(K, n_m) entries of a flat array, so the memory is bounded by the number of words
+ * instead of M x K.
+ * A doc is sampled on a dense copy of its counts, made by load() and written back by store().
+ */
+class SparseCounts
+{
+    std::vector<size_t> slots;              // the mth doc is in [slots[m], slots[m] + length[m])
+    std::vector<int> length;
+    std::vector<std::pair<int, int>> entries;
+public:
+    SparseCounts() = default;
+    ~SparseCounts() = default;
+    void init(const std::vector<int>& n_m, const int K);
+    int size(const int m) const { return length[m]; }
+    const std::pair<int, int> *begin(const int m) const { return entries.data() + slots[m]; }
+    const std::pair<int, int> *end(const int m) const { return entries.data() + slots[m] + length[m]; }
+    void load(const int m, int *n_z) const;
+    void store(const int m, const int *first, const int *last, int *n_z);
+};
+
+/**
+ * Allocate empty slots
+ *
+ * @param const std::vector<int>& n_m the number of words of each doc
+ * @param const int K the number of topics
+ */
+inline void SparseCounts::init(const std::vector<int>& n_m, const int K) {
+    const int M = n_m.size();
+    slots.resize(M + 1);
+    length.assign(M, 0);
+    slots[0] = 0;
+    for (int m = 0; m < M; ++m) {
+        slots[m+1] = slots[m] + std::min(K, n_m[m]);
+    }
+    entries.resize(slots[M]);
+}
+
+/**
+ * Add the counts of the mth doc to dense counts
+ *
+ * @param const int m the mth doc
+ * @param int *n_z dense counts, which are usually zero
+ */
+inline void SparseCounts::load(const int m, int *n_z) const {
+    for (auto it = begin(m); it != end(m); ++it) {
+        n_z[it->first] += it->second;
+    }
+}
+
+/**
+ * Replace the counts of the mth doc with dense counts, and Clear the dense counts
+ *
+ * Only the topics of the doc's words are read, so this takes no O(K) time.
+ *
+ * @param const int m the mth doc
+ * @param const int *first the topic of the first word of the doc
+ * @param const int *last the end of the topics of the doc
+ * @param int *n_z dense counts of the doc, which are zero on return
+ */
+inline void SparseCounts::store(const int m, const int *first, const int *last, int *n_z) {
+    auto slot = entries.begin() + slots[m];
+    int n = 0;
+    for (const int *z = first; z != last; ++z) {
+        if (n_z[*z] > 0) {
+            slot[n++] = std::make_pair(*z, n_z[*z]);
+            n_z[*z] = 0;
+        }
+    }
+    std::sort(slot, slot + n);
+    length[m] = n;
+}
+
+#endif
@@ -0,0 +1,85 @@
+/*
+ * TopicWeights.hpp
+ *
+ * Copyright (c) 2012 Tsukasa OMOTO <henry0312@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/* This file is available under an MIT license. */
+
+#ifndef TOPIC_WEIGHTS_H
+#define TOPIC_WEIGHTS_H
+
+#include <cstdint>
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+/**
+ * Load reciprocals as doubles
+ */
+#if defined(__AVX512F__)
+static inline __m512d load8_pd(const double *p) { return _mm512_loadu_pd(p); }
+static inline __m512d load8_pd(const float *p) { return _mm512_cvtps_pd(_mm256_loadu_ps(p)); }
+#elif defined(__AVX2__)
+static inline __m256d load4_pd(const double *p) { return _mm256_loadu_pd(p); }
+static inline __m256d load4_pd(const float *p) { return _mm256_cvtps_pd(_mm_loadu_ps(p)); }
+#endif
+
+/**
+ * Load counts as doubles
+ */
+#if defined(__AVX512F__)
+// the maskz_ variant doesn't rely on _mm512_undefined_pd(), which GCC 12 warns about
+static inline __m512d load8_pd(const int *p) {
+    return _mm512_maskz_cvtepi32_pd(0xFF, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p)));
+}
+static inline __m512d load8_pd(const uint16_t *p) {
+    return _mm512_maskz_cvtepi32_pd(0xFF, _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p))));
+}
+#elif defined(__AVX2__)
+static inline __m256d load4_pd(const int *p) {
+    return _mm256_cvtepi32_pd(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p)));
+}
+static inline __m256d load4_pd(const uint16_t *p) {
+    return _mm256_cvtepi32_pd(_mm_cvtepu16_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(p))));
+}
+#endif
+
+/**
+ * Compute p(z) = coef_z * (beta + n_tz) for all z
+ *
+ * @param const int K the number of topics
+ * @param const Real *coef_z (alpha_z + n_mz) / (n_z + V * beta)
+ * @param const double beta beta
+ * @param const Count *n_z_of_t n_tz of the tth word, int or uint16_t
+ * @param double *p_z output
+ */
+template <class Real, class Count>
+static inline void topic_weights(const int K, const Real *coef_z, const double beta,
+        const Count *n_z_of_t, double *p_z) {
+    int z = 0;
+#if defined(__AVX512F__)
+    const __m512d beta8 = _mm512_set1_pd(beta);
+    for (; z + 8 <= K; z += 8) {
+        const __m512d n = load8_pd(n_z_of_t + z);
+        _mm512_storeu_pd(p_z + z, _mm512_mul_pd(load8_pd(coef_z + z), _mm512_add_pd(beta8, n)));
+    }
+#elif defined(__AVX2__)
+    const __m256d beta4 = _mm256_set1_pd(beta);
+    for (; z + 4 <= K; z += 4) {
+        const __m256d n = load4_pd(n_z_of_t + z);
+        _mm256_storeu_pd(p_z + z, _mm256_mul_pd(load4_pd(coef_z + z), _mm256_add_pd(beta4, n)));
+    }
+#endif
+    for (; z < K; ++z) {
+        p_z[z] = coef_z[z] * (beta + n_z_of_t[z]);
+    }
+}
+
+#endif
@@ -0,0 +1,404 @@
+/*
+ * TopicWordCounts.hpp
+ *
+ * Copyright (c) 2012 Tsukasa OMOTO <henry0312@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/* This file is available under an MIT license. */
+
+#ifndef TOPIC_WORD_COUNTS_H
+#define TOPIC_WORD_COUNTS_H
+
+#include <iostream>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <limits>
+#include <cstdint>
+#include <cstdlib>
+#include <climits>
+
+/**
+ * Dense rows of counts of one width
+ */
+template<class Count>
+class CountRows
+{
+    std::vector<Count> counts;
+    int capacity;   // the length of rows
+public:
+    CountRows() : capacity(0) {}
+    ~CountRows() = default;
+    void assign(const int rows, const int _capacity) {
+        capacity = _capacity;
+        counts.assign(static_cast<size_t>(rows) * capacity, 0);
+    }
+    Count *operator[](const int r) { return counts.data() + static_cast<size_t>(r) * capacity; }
+    const Count *operator[](const int r) const { return counts.data() + static_cast<size_t>(r) * capacity; }
+    size_t bytes() const { return counts.size() * sizeof(Count); }
+};
+
+/**
+ * Topic counts of words, dense for frequent words and sparse for the others
+ *
+ * A word which occurs n_t times has at most min(K, n_t) nonzero counts, and none of them exceeds n_t.
+ * So the counts of a word with n_t <= 65535 are kept in 16 bits and never overflow;
+ * only more frequent words are promoted to 32 bits.
+ * If min(K, n_t) (topic, count) pairs take as much memory as a dense row of that width,
+ * the word has a dense row; otherwise its pairs are kept sorted by topic in a slot of min(K, n_t) entries.
+ * The split is decided by init() from the frequencies of words,
+ * and decided again when the capacity of topics is exceeded by resize().
+ * Define LDA_WIDE_COUNTS to keep all dense rows in 32 bits.
+ */
+class TopicWordCounts
+{
+#ifdef LDA_WIDE_COUNTS
+    static const int narrow_limit = 0;
+#else
+    static const int narrow_limit = std::numeric_limits<uint16_t>::max();
+#endif
+
+    int K;                                  // the number of topics
+    int capacity;                           // the length of dense rows, >= K
+    std::vector<int> n_t;                   // frequencies of words
+    std::vector<int> row_t;                 // the dense row of the t-th word, -1 if sparse
+    std::vector<char> narrow_t;             // whether the dense row is in narrow or wide
+    CountRows<uint16_t> narrow;             // n_t <= narrow_limit
+    CountRows<int> wide;
+    std::vector<size_t> slots;              // the sparse t-th word is in [slots[t], slots[t] + length[t])
+    std::vector<int> length;
+    std::vector<std::pair<int, int>> entries;
+    int narrow_rows;
+    int wide_rows;
+
+    std::pair<int, int> *find(const int t, const int z);
+    void layout(const int _capacity);
+    template<class Count, class F> void for_each_dense(const Count *n_z, F& f) const;
+public:
+    TopicWordCounts() : K(0), capacity(0), narrow_rows(0), wide_rows(0) {}
+    ~TopicWordCounts() = default;
+    void init(const std::vector<int64_t>& _n_t, const int _K);
+    void resize(const int _K);
+    void relabel(const std::vector<int>& new_z, const int _K);
+    bool is_dense(const int t) const { return row_t[t] >= 0; }
+    int get(const int t, const int z) const;
+    void add(const int t, const int z, const int delta);
+    template<class F> void for_each(const int t, F f) const;
+    const uint16_t *narrow_row(const int t) const;
+    int *row(const int t, int *buffer);
+    void clear(const int t, int *buffer) const;
+    void load(const int t, int *n_z, const int weight = 1) const;
+    void store(const int t, int *n_z);
+    int count_dense() const { return narrow_rows + wide_rows; }
+    int count_narrow() const { return narrow_rows; }
+    size_t bytes() const;
+    size_t dense_bytes() const { return n_t.size() * static_cast<size_t>(K) * sizeof(int); }
+};
+
+/**
+ * Allocate zero counts
+ *
+ * Counts are at most 32 bits, so no word may occur more than INT_MAX times.
+ *
+ * @param const std::vector<int64_t>& _n_t the number of times each word occurs
+ * @param const int _K the number of topics
+ */
+inline void TopicWordCounts::init(const std::vector<int64_t>& _n_t, const int _K) {
+    n_t.resize(_n_t.size());
+    for (size_t t = 0; t < _n_t.size(); ++t) {
+        if (_n_t[t] > INT_MAX) {
+            std::cerr << "The word " << t + 1 << " occurs more than " << INT_MAX << " times" << std::endl;
+            exit(1);
+        }
+        n_t[t] = _n_t[t];
+    }
+    K = _K;
+    layout(std::max(K, 1));
+}
+
+/**
+ * Lay out zero counts for a capacity of topics
+ *
+ * @param const int _capacity the length of dense rows
+ */
+inline void TopicWordCounts::layout(const int _capacity) {
+    const int V = n_t.size();
+    capacity = _capacity;
+    row_t.resize(V);
+    narrow_t.assign(V, 0);
+    slots.resize(V + 1);
+    length.assign(V, 0);
+    narrow_rows = wide_rows = 0;
+    slots[0] = 0;
+    for (int t = 0; t < V; ++t) {
+        const int size = std::min(capacity, n_t[t]);
+        const bool is_narrow = n_t[t] <= narrow_limit;
+        const size_t row_bytes = static_cast<size_t>(capacity) * (is_narrow ? sizeof(uint16_t) : sizeof(int));
+        if (size > 0 && size * sizeof(std::pair<int, int>) >= row_bytes) {
+            row_t[t] = is_narrow ? narrow_rows++ : wide_rows++;
+            narrow_t[t] = is_narrow;
+            slots[t+1] = slots[t];
+        } else {
+            row_t[t] = -1;
+            slots[t+1] = slots[t] + size;
+        }
+    }
+    narrow.assign(narrow_rows, capacity);
+    wide.assign(wide_rows, capacity);
+    entries.assign(slots[V], std::make_pair(0, 0));
+}
+
+/**
+ * Increase the number of topics
+ *
+ * The counts are kept. If the capacity is exceeded, it is doubled and the words are split again.
+ *
+ * @param const int _K the number of topics, which is not less than the current one
+ */
+inline void TopicWordCounts::resize(const int _K) {
+    if (_K > capacity) {
+        TopicWordCounts old;
+        std::swap(*this, old);
+        n_t.swap(old.n_t);
+        layout(std::max(_K, 2 * old.capacity));
+        K = _K;
+        std::vector<int> n_z(capacity, 0);
+        for (int t = 0; t < static_cast<int>(n_t.size()); ++t) {
+            old.load(t, n_z.data());
+            store(t, n_z.data());
+        }
+    }
+    K = _K;
+}
+
+/**
+ * Renumber the topics
+ *
+ * Topic z becomes new_z[z]. Topics with new_z[z] < 0 must have no counts, and are dropped.
+ * The capacity is shrunk to the new number of topics and the words are split again.
+ *
+ * @param const std::vector<int>& new_z the new number of each topic
+ * @param const int _K the new number of topics
+ */
+inline void TopicWordCounts::relabel(const std::vector<int>& new_z, const int _K) {
+    TopicWordCounts old;
+    std::swap(*this, old);
+    n_t.swap(old.n_t);
+    layout(std::max(_K, 1));
+    K = _K;
+    std::vector<int> n_z(capacity, 0);
+    for (int t = 0; t < static_cast<int>(n_t.size()); ++t) {
+        old.for_each(t, [&](const int z, const int count) { n_z[ new_z[z] ] = count; });
+        store(t, n_z.data());
+    }
+}
+
+/**
+ * Find the pair of a topic in the slot of a sparse word
+ *
+ * @return the pair, or the position where it should be inserted
+ */
+inline std::pair<int, int> *TopicWordCounts::find(const int t, const int z) {
+    auto first = entries.data() + slots[t];
+    return std::lower_bound(first, first + length[t], std::make_pair(z, 0),
+            [](const std::pair<int, int>& a, const std::pair<int, int>& b) -> bool
+            { return a.first < b.first; });
+}
+
+/**
+ * Get n_tz
+ *
+ * @param const int t the t-th word
+ * @param const int z topic
+ */
+inline int TopicWordCounts::get(const int t, const int z) const {
+    const int r = row_t[t];
+    if (r >= 0) {
+        return narrow_t[t] ? narrow[r][z] : wide[r][z];
+    }
+    auto it = const_cast<TopicWordCounts *>(this)->find(t, z);
+    if (it != entries.data() + slots[t] + length[t] && it->first == z) {
+        return it->second;
+    }
+    return 0;
+}
+
+/**
+ * Add delta to n_tz
+ *
+ * A pair is inserted or erased when a sparse count becomes nonzero or zero.
+ *
+ * @param const int t the t-th word
+ * @param const int z topic
+ * @param const int delta
+ */
+inline void TopicWordCounts::add(const int t, const int z, const int delta) {
+    const int r = row_t[t];
+    if (r >= 0) {
+        if (narrow_t[t]) {
+            narrow[r][z] += delta;
+        } else {
+            wide[r][z] += delta;
+        }
+        return;
+    }
+    if (delta == 0) {
+        return;
+    }
+    auto last = entries.data() + slots[t] + length[t];
+    auto it = find(t, z);
+    if (it != last && it->first == z) {
+        it->second += delta;
+        if (it->second == 0) {
+            std::copy(it + 1, last, it);
+            --length[t];
+        }
+    } else {
+        std::copy_backward(it, last, last + 1);
+        *it = std::make_pair(z, delta);
+        ++length[t];
+    }
+}
+
+/**
+ * Call f(z, n_tz) for each nonzero count of a dense row
+ */
+template<class Count, class F>
+inline void TopicWordCounts::for_each_dense(const Count *n_z, F& f) const {
+    for (int z = 0; z < K; ++z) {
+        if (n_z[z] != 0) {
+            f(z, static_cast<int>(n_z[z]));
+        }
+    }
+}
+
+/**
+ * Call f(z, n_tz) for each nonzero count of a word in ascending order of topics
+ *
+ * @param const int t the t-th word
+ * @param F f
+ */
+template<class F>
+inline void TopicWordCounts::for_each(const int t, F f) const {
+    const int r = row_t[t];
+    if (r >= 0) {
+        if (narrow_t[t]) {
+            for_each_dense(narrow[r], f);
+        } else {
+            for_each_dense(wide[r], f);
+        }
+    } else {
+        for (auto it = entries.data() + slots[t]; it != entries.data() + slots[t] + length[t]; ++it) {
+            f(it->first, it->second);
+        }
+    }
+}
+
+/**
+ * Get the narrow dense row of a word
+ *
+ * @param const int t the t-th word
+ * @return the row, or nullptr if the word isn't kept in a narrow row
+ */
+inline const uint16_t *TopicWordCounts::narrow_row(const int t) const {
+    if (row_t[t] >= 0 && narrow_t[t]) {
+        return narrow[row_t[t]];
+    }
+    return nullptr;
+}
+
+/**
+ * Get the counts of a word as ints
+ *
+ * A word without a wide row is copied into the buffer, which must be cleared by clear() afterwards.
+ *
+ * @param const int t the t-th word
+ * @param int *buffer K zeros
+ * @return the wide row, or the buffer
+ */
+inline int *TopicWordCounts::row(const int t, int *buffer) {
+    if (row_t[t] >= 0 && !narrow_t[t]) {
+        return wide[row_t[t]];
+    }
+    load(t, buffer);
+    return buffer;
+}
+
+/**
+ * Clear the buffer given to row()
+ *
+ * The counts of the word may have been increased since row(), but must not have been decreased.
+ *
+ * @param const int t the t-th word
+ * @param int *buffer
+ */
+inline void TopicWordCounts::clear(const int t, int *buffer) const {
+    if (row_t[t] >= 0) {
+        if (narrow_t[t]) {
+            std::fill(buffer, buffer + K, 0);
+        }
+    } else {
+        for (auto it = entries.data() + slots[t]; it != entries.data() + slots[t] + length[t]; ++it) {
+            buffer[it->first] = 0;
+        }
+    }
+}
+
+/**
+ * Add the counts of a word, multiplied by weight, to dense counts
+ *
+ * @param const int t the t-th word
+ * @param int *n_z dense counts
+ * @param const int weight
+ */
+inline void TopicWordCounts::load(const int t, int *n_z, const int weight) const {
+    for_each(t, [&](const int z, const int n) { n_z[z] += weight * n; });
+}
+
+/**
+ * Replace the counts of a word with dense counts, and Clear the dense counts
+ *
+ * This takes O(K) time.
+ *
+ * @param const int t the t-th word
+ * @param int *n_z K dense counts, which are zero on return
+ */
+inline void TopicWordCounts::store(const int t, int *n_z) {
+    const int r = row_t[t];
+    if (r >= 0) {
+        if (narrow_t[t]) {
+            std::copy(n_z, n_z + K, narrow[r]);
+        } else {
+            std::copy(n_z, n_z + K, wide[r]);
+        }
+        std::fill(n_z, n_z + K, 0);
+        return;
+    }
+    auto slot = entries.data() + slots[t];
+    int n = 0;
+    for (int z = 0; z < K; ++z) {
+        if (n_z[z] != 0) {
+            slot[n++] = std::make_pair(z, n_z[z]);
+            n_z[z] = 0;
+        }
+    }
+    length[t] = n;
+}
+
+/**
+ * Get the memory used by the counts
+ *
+ * @return bytes
+ */
+inline size_t TopicWordCounts::bytes() const {
+    return narrow.bytes() + wide.bytes() + entries.size() * sizeof(std::pair<int, int>)
+        + slots.size() * sizeof(size_t) + (row_t.size() + length.size()) * sizeof(int) + narrow_t.size();
+}
+
+#endif
@@ -0,0 +1,61 @@
+/*
+ * WordHistogram.hpp
+ *
+ * Copyright (c) 2012 Tsukasa OMOTO <henry0312@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/* This file is available under an MIT license. */
+
+#ifndef WORD_HISTOGRAM_H
+#define WORD_HISTOGRAM_H
+
+#include <vector>
+#include <utility>
+#include <algorithm>
+
+/**
+ * Sparse word counts of a table
+ *
+ * The nonzero counts are kept as (word, count) pairs sorted by word,
+ * so a table takes memory for its distinct words instead of V counts.
+ */
+class WordHistogram
+{
+    std::vector<std::pair<int, int>> entries;
+public:
+    WordHistogram() = default;
+    ~WordHistogram() = default;
+    void add(const int v, const int delta);
+    void clear() { entries.clear(); }
+    bool empty() const { return entries.empty(); }
+    std::vector<std::pair<int, int>>::const_iterator begin() const { return entries.begin(); }
+    std::vector<std::pair<int, int>>::const_iterator end() const { return entries.end(); }
+};
+
+/**
+ * Add delta to the count of a word
+ *
+ * A pair is inserted for a new word and erased when its count becomes zero.
+ *
+ * @param const int v the word
+ * @param const int delta the amount to add
+ */
+inline void WordHistogram::add(const int v, const int delta) {
+    auto it = std::lower_bound(entries.begin(), entries.end(), std::make_pair(v, 0));
+    if (it != entries.end() && it->first == v) {
+        it->second += delta;
+        if (it->second == 0) {
+            entries.erase(it);
+        }
+    } else {
+        entries.insert(it, std::make_pair(v, delta));
+    }
+}
+
+#endif